@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "SmartChargeSvc::ActionPlan"
+
+#include "ActionPlan.h"
+
+#include <log/log.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using ScopedLock = const std::lock_guard<std::mutex>;
+
+void ActionPlan::setAction(const bool enable, const Handler handler,
+                           const std::string &node, const std::string &data) {
+  Action &action = mActions[enable];
+
+  action.valid = true;
+  action.handler = handler;
+  action.node = node;
+  action.payload = data;
+  openNode(action);
+  mLastApplied = kUnknown;
+}
+
+bool ActionPlan::openNode(Action &action) {
+  const int flags = action.handler == Handler::WRITE_FILE ? O_WRONLY : O_RDONLY;
+
+  action.fd.reset(open(action.node.c_str(), flags | O_CLOEXEC));
+  if (action.fd < 0) {
+    ALOGE("%s: Failed to open %s: %s", __func__, action.node.c_str(), strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void ActionPlan::setOffload(const std::string &node, const std::vector<int> &levels,
+                            const std::string &release) {
+  mOffload.valid = true;
+  mOffload.node = node;
+  mOffload.release = release;
+  mOffload.levels = levels;
+  mOffload.refused.clear();
+  // Read back after writing, to tell whether the firmware took the cap
+  mOffload.fd.reset(open(node.c_str(), O_RDWR | O_CLOEXEC));
+  if (mOffload.fd < 0)
+    ALOGE("%s: Failed to open %s: %s", __func__, node.c_str(), strerror(errno));
+  mOffloaded = kUnknown;
+}
+
+bool ActionPlan::isComplete(void) const {
+  return mActions[true].valid && mActions[false].valid;
+}
+
+bool ActionPlan::hasSameActions(const ActionPlan &other) const {
+  for (size_t i = 0; i < mActions.size(); ++i) {
+    const Action &a = mActions[i], &b = other.mActions[i];
+    if (a.valid != b.valid)
+      return false;
+    if (a.valid && (a.handler != b.handler || a.node != b.node || a.payload != b.payload))
+      return false;
+  }
+  if (mOffload.valid != other.mOffload.valid)
+    return false;
+  return !mOffload.valid ||
+         (mOffload.node == other.mOffload.node && mOffload.release == other.mOffload.release &&
+          mOffload.levels == other.mOffload.levels);
+}
+
+bool ActionPlan::perform(Action &action) {
+  char buf[16];
+  ssize_t rc;
+
+  // Not there when the plan was built, it may have shown up since
+  if (action.fd < 0 && !openNode(action))
+    return false;
+  switch (action.handler) {
+  case Handler::OPEN_FILE:
+    ALOGD("Reading node: %s", action.node.c_str());
+    rc = TEMP_FAILURE_RETRY(pread(action.fd, buf, sizeof(buf), 0));
+    break;
+  case Handler::WRITE_FILE:
+    ALOGD("Writing to node: %s", action.payload.c_str());
+    rc = TEMP_FAILURE_RETRY(
+        pwrite(action.fd, action.payload.data(), action.payload.size(), 0));
+    break;
+  default:
+    return false;
+  }
+  if (rc < 0) {
+    ALOGE("%s: %s: %s", __func__, action.node.c_str(), strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void ActionPlan::apply(const bool enable) {
+  if (!mActions[enable].valid)
+    return;
+  // Same state as last time, the node already holds it
+  if (mLastApplied.exchange(enable) == enable)
+    return;
+  ScopedLock _(mApplyLock);
+  if (!perform(mActions[enable]))
+    mLastApplied = kUnknown;
+}
+
+bool ActionPlan::canOffload(const int upper) const {
+  const auto has = [upper](const std::vector<int> &v) {
+    return std::find(v.begin(), v.end(), upper) != v.end();
+  };
+  return mOffload.valid && mOffload.fd >= 0 && has(mOffload.levels) &&
+         !has(mOffload.refused);
+}
+
+bool ActionPlan::offload(const int upper) {
+  char buf[16];
+  ssize_t rc;
+
+  if (!canOffload(upper))
+    return false;
+  if (mOffloaded == upper)
+    return true;
+  const int len = snprintf(buf, sizeof(buf), "%d", upper);
+  ALOGD("Writing to node: %s", buf);
+  rc = TEMP_FAILURE_RETRY(pwrite(mOffload.fd, buf, len, 0));
+  if (rc < 0) {
+    ALOGE("%s: %s: %s", __func__, mOffload.node.c_str(), strerror(errno));
+    mOffloaded = kUnknown;
+    return false;
+  }
+  // Some firmware silently ignores caps it does not support
+  rc = TEMP_FAILURE_RETRY(pread(mOffload.fd, buf, sizeof(buf) - 1, 0));
+  if (rc > 0)
+    buf[rc] = '\0';
+  if (rc <= 0 || strtol(buf, nullptr, 10) != upper) {
+    ALOGW("%s: %s did not take %d, not offloading it again", __func__,
+          mOffload.node.c_str(), upper);
+    mOffload.refused.push_back(upper);
+    releaseOffload();
+    return false;
+  }
+  mOffloaded = upper;
+  return true;
+}
+
+void ActionPlan::releaseOffload(void) {
+  if (!mOffload.valid || mOffload.fd < 0)
+    return;
+  // Written even if nothing is known to be in effect, a refused cap may
+  // still have been taken in some form
+  ALOGD("Writing to node: %s", mOffload.release.c_str());
+  if (TEMP_FAILURE_RETRY(pwrite(mOffload.fd, mOffload.release.data(),
+                                mOffload.release.size(), 0)) < 0)
+    ALOGE("%s: %s: %s", __func__, mOffload.node.c_str(), strerror(errno));
+  mOffloaded = kUnknown;
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
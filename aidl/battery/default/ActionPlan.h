@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Charge control actions of a device entry, compiled once.
+ *
+ * Nodes are opened up front and payloads are kept ready to write, so
+ * toggling charge is a single pread/pwrite (or nothing at all, if the same
+ * state was applied last time) without any heap allocation.
+ */
+class ActionPlan {
+public:
+  enum class Handler {
+    // Read the node, the read itself triggers the action
+    OPEN_FILE,
+    // Write handler_data to the node
+    WRITE_FILE,
+  };
+
+  /**
+   * Set the action performed for either state.
+   *
+   * @param enable true for the charge enable action, false for disable
+   * @param handler What to do with the node
+   * @param node Path of the node
+   * @param data Payload for WRITE_FILE, unused otherwise
+   */
+  void setAction(const bool enable, const Handler handler,
+                 const std::string &node, const std::string &data);
+
+  /**
+   * Set the firmware enforced charge cap, if the device has one.
+   *
+   * @param node Path of the node, takes the cap in percent
+   * @param levels Caps the firmware can hold charge at
+   * @param release Payload lifting the cap again
+   */
+  void setOffload(const std::string &node, const std::vector<int> &levels,
+                  const std::string &release);
+
+  // True if both enable and disable actions are set
+  bool isComplete(void) const;
+  // True if both plans act on the same nodes the same way
+  bool hasSameActions(const ActionPlan &other) const;
+
+  /**
+   * Enable or disable charging, thread safe. A node that could not be
+   * opened, e.g. its driver probes late, is opened again first.
+   */
+  void apply(const bool enable);
+
+  // Forget the last applied state, so next apply() writes unconditionally
+  void invalidate(void) { mLastApplied = kUnknown; }
+
+  // True if firmware can hold charge at upper and did not refuse it before
+  bool canOffload(const int upper) const;
+  /**
+   * Program the firmware cap, read back to confirm it was taken. A refused
+   * cap is not offered by canOffload() again.
+   *
+   * @return false if the cap is not in effect
+   */
+  bool offload(const int upper);
+  // Lift the cap programmed by offload(), if any
+  void releaseOffload(void);
+  // Cap in effect, or -1 if none
+  int getOffloaded(void) const { return mOffloaded; }
+
+  // Node acted on for either state, empty if unset
+  const std::string &getNode(const bool enable) const { return mActions[enable].node; }
+
+  // Device entry the actions came from, e.g. "codename:a52q", for status
+  void setMatch(const std::string &match) { mMatch = match; }
+  const std::string &getMatch(void) const { return mMatch; }
+
+private:
+  struct Action {
+    bool valid = false;
+    Handler handler;
+    std::string node;
+    std::string payload;
+    ::android::base::unique_fd fd;
+  };
+  static constexpr int kUnknown = -1;
+
+  // Open the node of action, returns false on failure
+  static bool openNode(Action &action);
+  // Returns false on failure
+  static bool perform(Action &action);
+
+  // Indexed by enable
+  std::array<Action, 2> mActions;
+  // Serialize perform(), it may reopen the node
+  std::mutex mApplyLock;
+  std::atomic_int mLastApplied = kUnknown;
+
+  struct Offload {
+    bool valid = false;
+    std::string node;
+    std::string release;
+    std::vector<int> levels;
+    // Levels the firmware did not take
+    std::vector<int> refused;
+    ::android::base::unique_fd fd;
+  } mOffload;
+  std::atomic_int mOffloaded = kUnknown;
+  std::string mMatch;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
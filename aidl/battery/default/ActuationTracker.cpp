@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "ActuationTracker.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using ScopedLock = const std::lock_guard<std::mutex>;
+
+// Histogram index of an actuation not accounted anywhere
+static constexpr size_t kNoHistogram = SIZE_MAX;
+
+static const char *stateToString(const ChargeStatus state) {
+  return state == ChargeStatus::ON ? "enable" : "disable";
+}
+
+ActuationTracker::Histogram *
+ActuationTracker::findHistogram(const ChargeStatus state, const std::string &node) {
+  for (auto &histogram : mHistograms) {
+    if (histogram.state == state && histogram.node == node)
+      return &histogram;
+  }
+  if (mHistograms.size() == kMaxHistograms)
+    return nullptr;
+  mHistograms.push_back({});
+  mHistograms.back().state = state;
+  mHistograms.back().node = node;
+  return &mHistograms.back();
+}
+
+void ActuationTracker::onActuation(const Duration now, const ChargeStatus state,
+                                   const std::string &node) {
+  ScopedLock _(mLock);
+
+  // Asked again while waiting for confirmation, keep timing the first write
+  if (mPending.active && mPending.state == state)
+    return;
+  const Histogram *histogram = findHistogram(state, node);
+  mPending.active = true;
+  mPending.state = state;
+  mPending.histogram = histogram ? histogram - mHistograms.data() : kNoHistogram;
+  mPending.since = now;
+  mPending.deadline = now + kFirstRetry;
+  mPending.retries = 0;
+}
+
+bool ActuationTracker::onSample(const Duration now, const HealthSample &sample) {
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+  ScopedLock _(mLock);
+
+  if (!mPending.active)
+    return false;
+  if (!sample.statusKnown || sample.status != mPending.state) {
+    // Unplugged meanwhile, nothing to confirm and nothing to write again
+    if (sample.chargerKnown && !sample.chargerOnline)
+      mPending.active = false;
+    return false;
+  }
+  mPending.active = false;
+  if (mPending.histogram == kNoHistogram)
+    return true;
+
+  Histogram &histogram = mHistograms[mPending.histogram];
+  const int64_t ms = duration_cast<milliseconds>(now - mPending.since).count();
+  const auto bucket = std::lower_bound(kBucketsMs.begin(), kBucketsMs.end(), ms);
+  ++histogram.buckets[bucket - kBucketsMs.begin()];
+  ++histogram.count;
+  histogram.maxMs = std::max(histogram.maxMs, ms);
+  return true;
+}
+
+bool ActuationTracker::shouldRetry(const Duration now, ChargeStatus *state) {
+  ScopedLock _(mLock);
+
+  if (!mPending.active || now < mPending.deadline)
+    return false;
+  Histogram *histogram =
+      mPending.histogram == kNoHistogram ? nullptr : &mHistograms[mPending.histogram];
+  if (mPending.retries == kMaxRetries) {
+    mPending.active = false;
+    if (histogram)
+      ++histogram->unconfirmed;
+    return false;
+  }
+  ++mPending.retries;
+  mPending.deadline = now + kFirstRetry * (1 << mPending.retries);
+  if (histogram)
+    ++histogram->retries;
+  *state = mPending.state;
+  return true;
+}
+
+ActuationTracker::Duration ActuationTracker::timeToRetry(const Duration now) const {
+  ScopedLock _(mLock);
+
+  if (!mPending.active)
+    return Duration::max();
+  return std::max(mPending.deadline - now, Duration::zero());
+}
+
+void ActuationTracker::cancel(void) {
+  ScopedLock _(mLock);
+  mPending.active = false;
+}
+
+int64_t ActuationTracker::percentileMs(const Histogram &histogram, const int percent) {
+  // Rank of the sample in question, rounded up
+  const uint64_t rank = (histogram.count * percent + 99) / 100;
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < kBucketsMs.size(); ++i) {
+    seen += histogram.buckets[i];
+    if (seen >= rank && seen > 0)
+      return std::min(kBucketsMs[i], histogram.maxMs);
+  }
+  return 0;
+}
+
+void ActuationTracker::dump(const int fd, const bool json) const {
+  ScopedLock _(mLock);
+  bool comma = false;
+
+  if (json)
+    dprintf(fd, "[");
+  for (const auto &h : mHistograms) {
+    const long long p50 = percentileMs(h, 50), p90 = percentileMs(h, 90),
+                    p99 = percentileMs(h, 99);
+    if (json) {
+      dprintf(fd,
+              "%s{\"action\":\"%s\",\"node\":\"%s\",\"confirmed\":%llu,"
+              "\"latency_ms\":{\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"max\":%lld},"
+              "\"retries\":%llu,\"unconfirmed\":%llu}",
+              comma ? "," : "", stateToString(h.state), h.node.c_str(),
+              (unsigned long long)h.count, p50, p90, p99, (long long)h.maxMs,
+              (unsigned long long)h.retries, (unsigned long long)h.unconfirmed);
+      comma = true;
+      continue;
+    }
+    dprintf(fd, "Actuation %s %s:\n", stateToString(h.state), h.node.c_str());
+    dprintf(fd, "  Confirmed: %llu, retries: %llu, unconfirmed: %llu\n",
+            (unsigned long long)h.count, (unsigned long long)h.retries,
+            (unsigned long long)h.unconfirmed);
+    if (h.count > 0)
+      dprintf(fd, "  Latency (p50/p90/p99/max): %lldms %lldms %lldms %lldms\n", p50, p90,
+              p99, (long long)h.maxMs);
+  }
+  if (json)
+    dprintf(fd, "]");
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
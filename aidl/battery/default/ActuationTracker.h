@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "HealthSource.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Closes the loop on charge actuations, without any I/O.
+ *
+ * Every actuation is timestamped, and confirmed by the first health sample
+ * reporting the charge status it asked for. The delay is kept in a
+ * histogram per action and node. Until confirmed, the node is due to be
+ * written again on a doubling backoff, and after kMaxRetries the actuation
+ * is given up on and counted as unconfirmed. Without a charger the status
+ * cannot follow, a sample saying so drops the pending actuation instead.
+ */
+class ActuationTracker {
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  static constexpr Duration kFirstRetry = std::chrono::seconds(5);
+  static constexpr int kMaxRetries = 3;
+
+  /**
+   * Charge control node was written.
+   *
+   * @param state State it was written for
+   * @param node Path of the node, keys the histogram with state
+   */
+  void onActuation(const Duration now, const ChargeStatus state,
+                   const std::string &node);
+  /**
+   * Returns true if the sample confirmed the pending actuation. Forgets it,
+   * uncounted, if the sample reports no charger.
+   */
+  bool onSample(const Duration now, const HealthSample &sample);
+  /**
+   * Whether the pending actuation is due to be written again. A retry is
+   * accounted as taken, the caller must write the node.
+   *
+   * @param state Set to the state to write again if true is returned
+   */
+  bool shouldRetry(const Duration now, ChargeStatus *state);
+  // Time until shouldRetry() is due, Duration::max() if nothing is pending
+  Duration timeToRetry(const Duration now) const;
+  // Forget the pending actuation, e.g. the loop stopped
+  void cancel(void);
+
+  // Output for dumpsys, fd is written with dprintf
+  void dump(const int fd, const bool json) const;
+
+private:
+  // Upper bounds of histogram buckets, the last one catches everything
+  static constexpr std::array<int64_t, 12> kBucketsMs = {
+      50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000, 300000, INT64_MAX,
+  };
+  // Nodes only change on a device entry reload, old ones are kept
+  static constexpr size_t kMaxHistograms = 8;
+
+  struct Histogram {
+    ChargeStatus state;
+    std::string node;
+    std::array<uint64_t, kBucketsMs.size()> buckets{};
+    uint64_t count = 0;
+    int64_t maxMs = 0;
+    uint64_t retries = 0;
+    uint64_t unconfirmed = 0;
+  };
+
+  // Returns null if there are too many already, mLock must be held
+  Histogram *findHistogram(const ChargeStatus state, const std::string &node);
+  // Latency below which percent of confirmations fall, as a bucket bound
+  static int64_t percentileMs(const Histogram &histogram, const int percent);
+
+  std::vector<Histogram> mHistograms;
+  struct {
+    bool active;
+    ChargeStatus state;
+    // Histogram of the first write, confirmation is timed from it
+    size_t histogram;
+    Duration since;
+    Duration deadline;
+    int retries;
+  } mPending = {};
+  // Protect above state, the loop records, dump reads
+  mutable std::mutex mLock;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "SmartChargeSvc::CallbackNotifier"
+
+#include "CallbackNotifier.h"
+
+#include <log/log.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using ScopedLock = const std::lock_guard<std::mutex>;
+
+static void kick(const int fd) {
+  uint64_t val = 1;
+  TEMP_FAILURE_RETRY(write(fd, &val, sizeof(val)));
+}
+
+CallbackNotifier::CallbackNotifier(Reactor &reactor)
+    : mDeathRecipient(AIBinder_DeathRecipient_new(onClientDied)) {
+  mWakeFd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+  if (mWakeFd < 0)
+    LOG_ALWAYS_FATAL("Failed to create eventfd: %s", strerror(errno));
+  reactor.add(mWakeFd, EPOLLIN, [this](uint32_t) {
+    uint64_t val;
+    TEMP_FAILURE_RETRY(read(mWakeFd, &val, sizeof(val)));
+    dispatch();
+  });
+}
+
+bool CallbackNotifier::registerCallback(
+    const std::shared_ptr<ISmartChargeCallback> &callback) {
+  AIBinder *const binder = callback->asBinder().get();
+  {
+    ScopedLock _(mLock);
+    for (const auto &client : mClients)
+      if (client.callback->asBinder().get() == binder)
+        return false;
+    // Current state right away
+    mClients.push_back({callback, mValid});
+  }
+  auto ret = AIBinder_linkToDeath(binder, mDeathRecipient.get(), this);
+  if (ret != STATUS_OK)
+    ALOGW("%s: linkToDeath failed: %d", __func__, ret);
+  kick(mWakeFd);
+  return true;
+}
+
+bool CallbackNotifier::unregisterCallback(
+    const std::shared_ptr<ISmartChargeCallback> &callback) {
+  AIBinder *const binder = callback->asBinder().get();
+  {
+    ScopedLock _(mLock);
+    auto it = std::find_if(mClients.begin(), mClients.end(), [binder](const Client &c) {
+      return c.callback->asBinder().get() == binder;
+    });
+    if (it == mClients.end())
+      return false;
+    mClients.erase(it);
+  }
+  AIBinder_unlinkToDeath(binder, mDeathRecipient.get(), this);
+  return true;
+}
+
+size_t CallbackNotifier::getClientCount(void) {
+  ScopedLock _(mLock);
+  return mClients.size();
+}
+
+void CallbackNotifier::postLocked(const uint32_t events) {
+  mValid |= events;
+  for (auto &client : mClients)
+    client.pending |= events;
+  if (!mClients.empty())
+    kick(mWakeFd);
+}
+
+void CallbackNotifier::notifyChargeControl(const bool chargingEnabled,
+                                           const int capacity) {
+  ScopedLock _(mLock);
+  mState.chargingEnabled = chargingEnabled;
+  mState.decisionCapacity = capacity;
+  postLocked(CHARGE_CONTROL);
+}
+
+void CallbackNotifier::notifyCapacity(const int capacity) {
+  ScopedLock _(mLock);
+  if ((mValid & CAPACITY) && mState.capacity == capacity)
+    return;
+  mState.capacity = capacity;
+  postLocked(CAPACITY);
+}
+
+void CallbackNotifier::notifyConfig(const ChargeConfig &config) {
+  ScopedLock _(mLock);
+  mState.config = config;
+  postLocked(CONFIG);
+}
+
+void CallbackNotifier::notifyLoopState(const bool running, const int reason) {
+  ScopedLock _(mLock);
+  mState.running = running;
+  mState.reason = reason;
+  postLocked(LOOP_STATE);
+}
+
+bool CallbackNotifier::deliver(const Client &client, const State &state) {
+  const auto &cb = client.callback;
+  ndk::ScopedAStatus ret = ndk::ScopedAStatus::ok();
+
+  // Config first, so the rest is seen in its light
+  if (ret.isOk() && (client.pending & CONFIG))
+    ret = cb->onConfigChanged(state.config.upper, state.config.lower,
+                              state.config.restart);
+  if (ret.isOk() && (client.pending & LOOP_STATE))
+    ret = cb->onLoopStateChanged(state.running, state.reason);
+  if (ret.isOk() && (client.pending & CAPACITY))
+    ret = cb->onCapacityChanged(state.capacity);
+  if (ret.isOk() && (client.pending & CHARGE_CONTROL))
+    ret = cb->onChargeControlChanged(state.chargingEnabled, state.decisionCapacity);
+  if (!ret.isOk()) {
+    ALOGW("%s: %s", __func__, ret.getDescription().c_str());
+    return ret.getStatus() != STATUS_DEAD_OBJECT;
+  }
+  return true;
+}
+
+void CallbackNotifier::dispatch(void) {
+  std::vector<Client> batch;
+  State state;
+
+  {
+    // Take what is pending, later updates kick the reactor again
+    ScopedLock _(mLock);
+    state = mState;
+    for (auto &client : mClients) {
+      if (client.pending == 0)
+        continue;
+      batch.push_back(client);
+      client.pending = 0;
+    }
+  }
+  // Oneway, so a slow client does not hold up the reactor
+  bool dead = false;
+  for (const auto &client : batch)
+    dead |= !deliver(client, state);
+  if (dead)
+    removeDeadClients();
+}
+
+void CallbackNotifier::onClientDied(void *cookie) {
+  static_cast<CallbackNotifier *>(cookie)->removeDeadClients();
+}
+
+void CallbackNotifier::removeDeadClients(void) {
+  ScopedLock _(mLock);
+  mClients.erase(std::remove_if(mClients.begin(), mClients.end(),
+                                [](const Client &c) {
+                                  return !AIBinder_isAlive(c.callback->asBinder().get());
+                                }),
+                 mClients.end());
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
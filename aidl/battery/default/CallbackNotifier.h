@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/vendor/samsung_ext/framework/battery/ISmartChargeCallback.h>
+
+#include <android-base/unique_fd.h>
+
+#include "ChargeController.h"
+#include "Reactor.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Fans out SmartCharge state to registered ISmartChargeCallbacks.
+ *
+ * notify*() only record the latest state and mark it pending for every
+ * client, so they never wait on binder. Pending updates are delivered from
+ * the reactor, updates of the same kind queued up for a client in the
+ * meantime collapse into the latest one.
+ */
+class CallbackNotifier {
+public:
+  explicit CallbackNotifier(Reactor &reactor);
+
+  // Returns false if callback was registered already
+  bool registerCallback(const std::shared_ptr<ISmartChargeCallback> &callback);
+  // Returns false if callback was not registered
+  bool unregisterCallback(const std::shared_ptr<ISmartChargeCallback> &callback);
+  size_t getClientCount(void);
+
+  void notifyChargeControl(const bool chargingEnabled, const int capacity);
+  // Nothing is sent if capacity did not change
+  void notifyCapacity(const int capacity);
+  void notifyConfig(const ChargeConfig &config);
+  void notifyLoopState(const bool running, const int reason);
+
+private:
+  enum Event : uint32_t {
+    CHARGE_CONTROL = 1 << 0,
+    CAPACITY = 1 << 1,
+    CONFIG = 1 << 2,
+    LOOP_STATE = 1 << 3,
+  };
+
+  struct State {
+    bool chargingEnabled;
+    int decisionCapacity;
+    int capacity;
+    ChargeConfig config;
+    bool running;
+    int reason;
+  };
+
+  struct Client {
+    std::shared_ptr<ISmartChargeCallback> callback;
+    // Events not delivered yet
+    uint32_t pending;
+  };
+
+  // mLock must be held
+  void postLocked(const uint32_t events);
+  // Deliver everything pending, on the reactor
+  void dispatch(void);
+  // Deliver events, without mLock held
+  static bool deliver(const Client &client, const State &state);
+  static void onClientDied(void *cookie);
+  void removeDeadClients(void);
+
+  std::vector<Client> mClients;
+  State mState = {};
+  // Events ever notified, sent to new clients
+  uint32_t mValid = 0;
+  // Protect above members
+  std::mutex mLock;
+  // eventfd kicking dispatch()
+  ::android::base::unique_fd mWakeFd;
+  ndk::ScopedAIBinder_DeathRecipient mDeathRecipient;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "ChargeController.h"
+
+#include <android-base/chrono_utils.h>
+
+#include <algorithm>
+#include <ctime>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using ScopedLock = const std::lock_guard<std::mutex>;
+
+using namespace std::chrono_literals;
+
+// Health HAL polling interval, until charge rate is known
+static constexpr auto kPollInterval = 5s;
+// Bounds of the wakeup predicted from charge rate
+static constexpr auto kMinWakeInterval = 5s;
+static constexpr auto kMaxWakeInterval = 10min;
+// Without uevents or pushed info, charger (un)plug is only seen on wakeup
+static constexpr auto kMaxPollInterval = 1min;
+
+Clock::Duration BootClock::now(void) const {
+  return ::android::base::boot_clock::now().time_since_epoch();
+}
+
+Clock::Duration BootClock::sinceLocalMidnight(void) const {
+  struct timespec ts = {};
+  struct tm tm = {};
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  localtime_r(&ts.tv_sec, &tm);
+  return std::chrono::hours(tm.tm_hour) + std::chrono::minutes(tm.tm_min) +
+         std::chrono::seconds(tm.tm_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+void ChargeController::reset(void) {
+  ScopedLock _(mLock);
+  mEstimator.reset();
+  mStatusKnown = false;
+  mActuated = false;
+  mTimeToLimit = Duration(-1);
+}
+
+ChargeController::Step ChargeController::step(const HealthSample &sample,
+                                              const ChargeConfig &config,
+                                              const bool eventDriven) {
+  const int per = sample.capacity;
+  const Duration now = mClock.now();
+  Step ret = {};
+  bool skip = false;
+  ScopedLock _(mLock);
+
+  if (sample.statusKnown) {
+    // Rate flips sign with charger state, old samples are useless then
+    if (mStatusKnown && mCurrent != sample.status) {
+      mEstimator.reset();
+      ret.statusChanged = true;
+    }
+    mCurrent = sample.status;
+    mStatusKnown = true;
+  }
+  mEstimator.addSample(now, per);
+  ret.wakeInterval = nextWakeInterval(config, eventDriven, now);
+
+  if (per > config.upper)
+    ret.policy = ChargeStatus::OFF;
+  else if (config.restart && per < config.lower)
+    ret.policy = ChargeStatus::ON;
+  else if (!config.restart && per < config.upper)
+    ret.policy = ChargeStatus::ON;
+  else
+    skip = true;
+  // Unknown charger state is never assumed to match the policy
+  ret.actuate = !skip && (!mStatusKnown || mCurrent != ret.policy);
+  // Unplugged, enabling charge cannot show in status. Written once, applying
+  // it again on every step would only rewrite the node.
+  if (ret.actuate && sample.chargerKnown && !sample.chargerOnline && mActuated &&
+      mLastPolicy == ret.policy)
+    ret.actuate = false;
+  if (ret.actuate) {
+    mActuated = true;
+    mLastPolicy = ret.policy;
+  }
+  return ret;
+}
+
+ChargeController::Duration
+ChargeController::nextWakeInterval(const ChargeConfig &config,
+                                   const bool eventDriven, const Duration now) {
+  const Duration maxInterval = eventDriven ? kMaxWakeInterval : kMaxPollInterval;
+  Duration left;
+  double rate;
+  int target;
+
+  mTimeToLimit = Duration(-1);
+  if (!mEstimator.getRate(&rate))
+    return eventDriven ? kMaxWakeInterval : kPollInterval;
+
+  // Charging crosses upper, discharging crosses lower or upper without restart
+  if (rate > 0 || !config.restart)
+    target = config.upper;
+  else
+    target = config.lower;
+  if (!mEstimator.predictTimeTo(target, now, &left))
+    return maxInterval;
+  mTimeToLimit = left;
+  return std::clamp<Duration>(left, kMinWakeInterval, maxInterval);
+}
+
+bool ChargeController::getRate(double *percentPerHour) const {
+  ScopedLock _(mLock);
+  return mEstimator.getRate(percentPerHour);
+}
+
+ChargeController::Duration ChargeController::getTimeToLimit(void) const {
+  ScopedLock _(mLock);
+  return mTimeToLimit;
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
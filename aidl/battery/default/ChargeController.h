@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "ChargeRateEstimator.h"
+#include "HealthSource.h"
+
+#include <chrono>
+#include <mutex>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+// Charge limit configuration, never modified once published
+struct ChargeConfig {
+  int upper;
+  int lower;
+  bool restart;
+};
+
+// Highest upper limit setChargeLimit() and setConfig() take
+static constexpr int kMaxUpperLimit = 95;
+// Lowest lower limit they take, unless unset (negative)
+static constexpr int kMinLowerLimit = 50;
+
+// Whether limits are within the range above, upper at most maxUpper
+static inline bool verifyChargeLimits(const int lower, const int upper,
+                                      const int maxUpper = kMaxUpperLimit) {
+  return !(upper <= lower || upper > maxUpper || (0 <= lower && lower < kMinLowerLimit));
+}
+
+// Time source of the policy, so it can be driven faster than real time
+class Clock {
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  virtual ~Clock() = default;
+  // Monotonic, counting while suspended
+  virtual Duration now(void) const = 0;
+  // Wall clock time since local midnight, jumps when time or zone is set
+  virtual Duration sinceLocalMidnight(void) const = 0;
+};
+
+// CLOCK_BOOTTIME, what the service runs on
+class BootClock : public Clock {
+public:
+  Duration now(void) const override;
+  Duration sinceLocalMidnight(void) const override;
+};
+
+/**
+ * SmartCharge charge policy and wakeup scheduling, without any I/O.
+ *
+ * The loop feeds every health sample to step() and does what it returns:
+ * applies the policy to the charge control node and sleeps for the returned
+ * interval unless an event comes first.
+ */
+class ChargeController {
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  struct Step {
+    // Policy differs from what the charger reports, apply it. Without a
+    // charger only once per policy, status cannot follow then.
+    bool actuate;
+    ChargeStatus policy;
+    // Charger state flipped since last step, e.g. replug. It may have reset
+    // the charge control node, so it must not be assumed to hold the policy.
+    bool statusChanged;
+    // How long the loop may sleep
+    Duration wakeInterval;
+  };
+
+  explicit ChargeController(const Clock &clock) : mClock(clock) {}
+
+  // Forget charger state and charge rate, e.g. when the loop starts
+  void reset(void);
+
+  /**
+   * Evaluate one health sample.
+   *
+   * @param sample Valid sample, i.e. backend read succeeded
+   * @param config Limits to enforce
+   * @param eventDriven Whether capacity and status changes wake the loop
+   *                    (uevent or pushed health info), or it has to poll
+   */
+  Step step(const HealthSample &sample, const ChargeConfig &config,
+            const bool eventDriven);
+
+  // Charge rate in percent per hour, false if unknown
+  bool getRate(double *percentPerHour) const;
+  // Predicted time until the limit is crossed, negative if unknown
+  Duration getTimeToLimit(void) const;
+
+private:
+  // mLock must be held
+  Duration nextWakeInterval(const ChargeConfig &config, const bool eventDriven,
+                            const Duration now);
+
+  const Clock &mClock;
+  ChargeRateEstimator mEstimator;
+  bool mStatusKnown = false;
+  ChargeStatus mCurrent = ChargeStatus::ON;
+  // Policy last asked to be applied, if any
+  bool mActuated = false;
+  ChargeStatus mLastPolicy = ChargeStatus::ON;
+  Duration mTimeToLimit{-1};
+  // Protect above state, step() runs on the loop, getters on dump
+  mutable std::mutex mLock;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
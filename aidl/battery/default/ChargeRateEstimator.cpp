@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "ChargeRateEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+
+void ChargeRateEstimator::reset(void) {
+  mHead = 0;
+  mCount = 0;
+  mLastCapacity = -1;
+  mSumX = mSumY = mSumXY = mSumXX = 0;
+}
+
+void ChargeRateEstimator::addSample(const Duration timestamp, const int capacity) {
+  if (capacity == mLastCapacity)
+    return;
+  if (mCount == 0)
+    mBase = timestamp;
+  mLastCapacity = capacity;
+  mLastTimestamp = timestamp;
+
+  const Sample sample = {duration<double>(timestamp - mBase).count(),
+                         static_cast<double>(capacity)};
+  if (mCount == kMaxSamples) {
+    // Evict the oldest one
+    const Sample &old = mSamples[mHead];
+    mSumX -= old.x;
+    mSumY -= old.y;
+    mSumXY -= old.x * old.y;
+    mSumXX -= old.x * old.x;
+  } else {
+    ++mCount;
+  }
+  mSamples[mHead] = sample;
+  mHead = (mHead + 1) % kMaxSamples;
+  mSumX += sample.x;
+  mSumY += sample.y;
+  mSumXY += sample.x * sample.y;
+  mSumXX += sample.x * sample.x;
+}
+
+bool ChargeRateEstimator::getRate(double *percentPerHour) const {
+  if (mCount < 2)
+    return false;
+  const double n = mCount;
+  const double denom = n * mSumXX - mSumX * mSumX;
+  if (denom <= 0)
+    return false;
+  *percentPerHour = (n * mSumXY - mSumX * mSumY) / denom * 3600;
+  return true;
+}
+
+bool ChargeRateEstimator::predictTimeTo(const int target, const Duration now,
+                                        Duration *out) const {
+  double rate;
+  if (!getRate(&rate) || std::fabs(rate) < 1e-6)
+    return false;
+  const double needed = target - mLastCapacity;
+  if (needed * rate < 0)
+    return false;
+  const double fromLast = needed / rate * 3600;
+  const double elapsed = duration<double>(now - mLastTimestamp).count();
+  *out = duration_cast<Duration>(duration<double>(std::max(fromLast - elapsed, 0.0)));
+  return true;
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Estimates battery charge (positive) or discharge (negative) rate from the
+ * last few capacity changes, using a least squares fit that is updated
+ * incrementally as samples enter and leave the ring buffer.
+ */
+class ChargeRateEstimator {
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  // Drop all samples, e.g. when the charger was plugged or unplugged
+  void reset(void);
+
+  /**
+   * Record capacity at a point in time. Samples with the same capacity as
+   * the previous one are ignored, as they carry no slope information.
+   *
+   * @param timestamp Monotonic timestamp, e.g. time since boot
+   * @param capacity Battery capacity in percent
+   */
+  void addSample(const Duration timestamp, const int capacity);
+
+  // Rate in percent per hour, false if there are not enough samples yet
+  bool getRate(double *percentPerHour) const;
+
+  /**
+   * Predict when the capacity reaches target.
+   *
+   * @param target Capacity to reach
+   * @param now Current timestamp, same clock as addSample
+   * @param out Time left from now
+   * @return false if unknown or target is never reached at current rate
+   */
+  bool predictTimeTo(const int target, const Duration now, Duration *out) const;
+
+private:
+  static constexpr size_t kMaxSamples = 8;
+
+  struct Sample {
+    double x; // seconds since mBase
+    double y; // capacity
+  };
+  std::array<Sample, kMaxSamples> mSamples;
+  size_t mHead = 0;
+  size_t mCount = 0;
+  Duration mBase{};
+  Duration mLastTimestamp{};
+  int mLastCapacity = -1;
+
+  // Running sums for the fit
+  double mSumX = 0, mSumY = 0, mSumXY = 0, mSumXX = 0;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "ChargeSchedule.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using std::chrono::minutes;
+
+static bool isValidWindow(const ChargeSchedule::Window &w) {
+  auto inDay = [](const int minute) {
+    return minute >= 0 && minute < ChargeSchedule::kMinutesPerDay;
+  };
+  if (!inDay(w.startMinute) || !inDay(w.endMinute) || w.startMinute == w.endMinute)
+    return false;
+  // Same limits setConfig() takes, except that upper may go past its cap up
+  // to full charge: topping up before the alarm is what windows are for
+  return w.upper >= 1 && verifyChargeLimits(w.lower, w.upper, 100);
+}
+
+ChargeSchedule::ChargeSchedule() {
+  mWindowAt.fill(kNoWindow);
+  mMinutesToChange.fill(0);
+}
+
+bool ChargeSchedule::setWindows(const std::vector<Window> &windows) {
+  std::array<uint8_t, kMinutesPerDay> windowAt;
+  std::array<uint16_t, kMinutesPerDay> minutesToChange;
+
+  if (windows.size() > kMaxWindows)
+    return false;
+  windowAt.fill(kNoWindow);
+  for (size_t i = 0; i < windows.size(); ++i) {
+    const auto &w = windows[i];
+    if (!isValidWindow(w))
+      return false;
+    for (int m = w.startMinute; m != w.endMinute; m = (m + 1) % kMinutesPerDay) {
+      if (windowAt[m] != kNoWindow)
+        return false;
+      windowAt[m] = i;
+    }
+  }
+
+  // Walk backwards from a boundary, so every minute sees its successor's
+  // distance already computed
+  minutesToChange.fill(0);
+  int boundary = -1;
+  for (int m = 0; m < kMinutesPerDay; ++m) {
+    if (windowAt[m] != windowAt[(m + kMinutesPerDay - 1) % kMinutesPerDay]) {
+      boundary = m;
+      break;
+    }
+  }
+  if (boundary >= 0) {
+    for (int i = 1; i <= kMinutesPerDay; ++i) {
+      const int m = (boundary - i + kMinutesPerDay) % kMinutesPerDay;
+      const int next = (m + 1) % kMinutesPerDay;
+      minutesToChange[m] = windowAt[m] != windowAt[next] ? 1 : minutesToChange[next] + 1;
+    }
+  }
+
+  mWindows = windows;
+  mWindowAt = windowAt;
+  mMinutesToChange = minutesToChange;
+  return true;
+}
+
+static int minuteOfDay(const ChargeSchedule::Duration sinceMidnight) {
+  const auto m = std::chrono::duration_cast<minutes>(sinceMidnight).count();
+  return ((m % ChargeSchedule::kMinutesPerDay) + ChargeSchedule::kMinutesPerDay) %
+         ChargeSchedule::kMinutesPerDay;
+}
+
+const ChargeSchedule::Window *ChargeSchedule::lookup(const Duration sinceMidnight) const {
+  const uint8_t i = mWindowAt[minuteOfDay(sinceMidnight)];
+  return i == kNoWindow ? nullptr : &mWindows[i];
+}
+
+ChargeSchedule::Duration
+ChargeSchedule::timeToNextBoundary(const Duration sinceMidnight) const {
+  const auto intoMinute = sinceMidnight % minutes(1);
+  const int m = minuteOfDay(sinceMidnight);
+
+  if (mMinutesToChange[m] == 0)
+    return Duration::max();
+  // Remainder of a negative time of day is negative too
+  return minutes(mMinutesToChange[m]) -
+         (intoMinute.count() < 0 ? intoMinute + minutes(1) : intoMinute);
+}
+
+ChargeConfig ChargeSchedule::apply(const ChargeConfig &base, const Window *window) {
+  ChargeConfig config = base;
+
+  if (window == nullptr)
+    return config;
+  config.upper = window->upper;
+  if (window->lower >= 0)
+    config.lower = window->lower;
+  else if (base.lower >= 0)
+    // Keep the configured hysteresis below the window's upper limit, so a
+    // higher limit resumes charging right away
+    config.lower = std::max(0, window->upper - (base.upper - base.lower));
+  return config;
+}
+
+std::string ChargeSchedule::toString(void) const {
+  std::string ret;
+  char buf[64];
+
+  for (const auto &w : mWindows) {
+    snprintf(buf, sizeof(buf), "%02d%02d-%02d%02d:%d:%d", w.startMinute / 60,
+             w.startMinute % 60, w.endMinute / 60, w.endMinute % 60, w.upper,
+             w.lower < 0 ? -1 : w.lower);
+    if (!ret.empty())
+      ret += ',';
+    ret += buf;
+  }
+  return ret;
+}
+
+bool ChargeSchedule::fromString(const std::string &str, std::vector<Window> *windows) {
+  std::stringstream ss(str);
+  std::string entry;
+
+  windows->clear();
+  while (std::getline(ss, entry, ',')) {
+    int sh, sm, eh, em, upper, lower, consumed = 0;
+    if (sscanf(entry.c_str(), "%2d%2d-%2d%2d:%d:%d%n", &sh, &sm, &eh, &em, &upper,
+               &lower, &consumed) != 6 ||
+        static_cast<size_t>(consumed) != entry.size())
+      return false;
+    if (sh < 0 || sh > 23 || eh < 0 || eh > 23 || sm < 0 || sm > 59 || em < 0 || em > 59)
+      return false;
+    windows->push_back({sh * 60 + sm, eh * 60 + em, upper, lower});
+  }
+  return true;
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "ChargeController.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Daily table of time windows with their own charge limits, e.g. hold at 80%
+ * overnight and top up to 100% before the alarm.
+ *
+ * Windows are compiled into per-minute tables once, so looking up the window
+ * of a time of day and the time until it changes is O(1) on every wakeup.
+ */
+class ChargeSchedule {
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  static constexpr int kMinutesPerDay = 24 * 60;
+  // Keeps the persisted form within a property value
+  static constexpr size_t kMaxWindows = 4;
+
+  struct Window {
+    // Minutes since local midnight, end exclusive. Wraps around midnight
+    // if end is before start.
+    int startMinute;
+    int endMinute;
+    int upper;
+    // Negative to keep the configured gap between the limits
+    int lower;
+  };
+
+  ChargeSchedule();
+
+  /**
+   * Replace the table.
+   *
+   * @return false, leaving the table as is, if there are too many windows,
+   *         any of them is empty or out of range, has invalid limits or
+   *         overlaps another one
+   */
+  bool setWindows(const std::vector<Window> &windows);
+  const std::vector<Window> &getWindows(void) const { return mWindows; }
+  bool empty(void) const { return mWindows.empty(); }
+
+  // Window covering a time of day, null if none does
+  const Window *lookup(const Duration sinceMidnight) const;
+  // Time until the window covering a time of day changes, Duration::max()
+  // if it never does
+  Duration timeToNextBoundary(const Duration sinceMidnight) const;
+
+  // Limits of the window, base config outside of any
+  static ChargeConfig apply(const ChargeConfig &base, const Window *window);
+
+  // "HHMM-HHMM:upper:lower" entries, comma separated
+  std::string toString(void) const;
+  static bool fromString(const std::string &str, std::vector<Window> *windows);
+
+private:
+  static constexpr uint8_t kNoWindow = 0xff;
+
+  std::vector<Window> mWindows;
+  // Index into mWindows for each minute of the day
+  std::array<uint8_t, kMinutesPerDay> mWindowAt;
+  // Minutes until mWindowAt changes, 0 if it never does
+  std::array<uint16_t, kMinutesPerDay> mMinutesToChange;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
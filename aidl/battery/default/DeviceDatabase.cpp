@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "SmartChargeSvc::DeviceDatabase"
+
+#include "DeviceDatabase.h"
+#include "SmartChargeNodes.h"
+
+#include <log/log.h>
+
+#include <vector>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+std::unique_ptr<ActionPlan> findCompiledEntry(const std::string &codename,
+                                              const std::string &vendor) {
+  const CompiledDevice *match = nullptr;
+  bool exact = false;
+
+  for (const auto &device : kCompiledDevices) {
+    if (device.codename[0] != '\0' && codename == device.codename) {
+      match = &device;
+      exact = true;
+      ALOGD("%s: Found a match with quality: EXACT", __func__);
+      break;
+    }
+    if (vendor == device.vendor)
+      match = &device;
+  }
+  if (match == nullptr) {
+    ALOGE("%s: No matching device found", __func__);
+    return nullptr;
+  }
+
+  auto plan = std::make_unique<ActionPlan>();
+  for (size_t i = 0; i < match->numActions; ++i) {
+    const auto &action = match->actions[i];
+    plan->setAction(action.enable, action.handler, action.node, action.data);
+  }
+  if (const auto *offload = match->offload)
+    plan->setOffload(offload->node,
+                     std::vector<int>(offload->levels, offload->levels + offload->numLevels),
+                     offload->release);
+  plan->setMatch(exact ? std::string("codename:") + match->codename
+                       : std::string("vendor:") + match->vendor);
+  return plan;
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "ActionPlan.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+// Device entries of smartcharge_nodes.json, compiled at build time
+struct CompiledAction {
+  bool enable;
+  ActionPlan::Handler handler;
+  const char *node;
+  const char *data;
+};
+
+// Firmware enforced charge cap, see ActionPlan::setOffload()
+struct CompiledOffload {
+  const char *node;
+  const char *release;
+  const int *levels;
+  size_t numLevels;
+};
+
+struct CompiledDevice {
+  const char *codename; // empty if vendor-wide
+  const char *vendor;
+  const CompiledAction *actions;
+  size_t numActions;
+  const CompiledOffload *offload; // null if none
+};
+
+/**
+ * Look up the device in the compiled table, with the same rules as
+ * ConfigParser: an exact codename match wins over a vendor match.
+ *
+ * @return Compiled actions of the matching device, null if none matches
+ */
+std::unique_ptr<ActionPlan> findCompiledEntry(const std::string &codename,
+                                              const std::string &vendor);
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "SmartChargeSvc::FileWatcher"
+
+#include "FileWatcher.h"
+
+#include <log/log.h>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using android::base::unique_fd;
+
+static constexpr uint32_t kWatchMask =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+// Quiet period closing a burst of events
+static constexpr int kSettleTimeMs = 200;
+
+std::unique_ptr<FileWatcher> FileWatcher::watch(const std::string &path,
+                                                Callback onChange) {
+  const size_t slash = path.rfind('/');
+  const std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+  const std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+  unique_fd inotifyFd(inotify_init1(IN_CLOEXEC | IN_NONBLOCK));
+  if (inotifyFd < 0) {
+    ALOGE("%s: inotify_init1: %s", __func__, strerror(errno));
+    return nullptr;
+  }
+  if (inotify_add_watch(inotifyFd, dir.c_str(), kWatchMask) < 0) {
+    ALOGE("%s: Failed to watch %s: %s", __func__, dir.c_str(), strerror(errno));
+    return nullptr;
+  }
+  unique_fd wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+  if (wakeFd < 0) {
+    ALOGE("%s: eventfd: %s", __func__, strerror(errno));
+    return nullptr;
+  }
+  return std::make_unique<FileWatcher>(std::move(inotifyFd), std::move(wakeFd), name,
+                                       std::move(onChange));
+}
+
+FileWatcher::FileWatcher(unique_fd inotifyFd, unique_fd wakeFd, std::string name,
+                         Callback onChange)
+    : mInotifyFd(std::move(inotifyFd)), mWakeFd(std::move(wakeFd)),
+      mName(std::move(name)), mOnChange(std::move(onChange)) {
+  mThread = std::thread(&FileWatcher::watchLoop, this);
+}
+
+FileWatcher::~FileWatcher() {
+  uint64_t val = 1;
+  TEMP_FAILURE_RETRY(write(mWakeFd, &val, sizeof(val)));
+  mThread.join();
+}
+
+bool FileWatcher::readEvents(void) {
+  alignas(struct inotify_event) char buf[4096];
+  bool matched = false;
+
+  while (true) {
+    const ssize_t n = TEMP_FAILURE_RETRY(read(mInotifyFd, buf, sizeof(buf)));
+    if (n <= 0) {
+      if (n < 0 && errno != EAGAIN)
+        ALOGE("%s: read: %s", __func__, strerror(errno));
+      return matched;
+    }
+    for (ssize_t off = 0; off < n;) {
+      const auto *event = reinterpret_cast<const struct inotify_event *>(buf + off);
+      if (event->mask & IN_Q_OVERFLOW)
+        matched = true;
+      else if (event->len > 0 && mName == event->name)
+        matched = true;
+      off += sizeof(struct inotify_event) + event->len;
+    }
+  }
+}
+
+void FileWatcher::watchLoop(void) {
+  struct pollfd fds[] = {
+      {mWakeFd, POLLIN, 0},
+      {mInotifyFd, POLLIN, 0},
+  };
+  bool pending = false;
+
+  while (true) {
+    // Wait for the burst to settle before reporting it
+    const int rc = poll(fds, std::size(fds), pending ? kSettleTimeMs : -1);
+    if (rc < 0) {
+      if (errno == EINTR)
+        continue;
+      ALOGE("%s: poll: %s", __func__, strerror(errno));
+      return;
+    }
+    if (fds[0].revents & POLLIN)
+      return;
+    if (rc == 0) {
+      pending = false;
+      mOnChange();
+      continue;
+    }
+    if (fds[1].revents & POLLIN)
+      pending |= readEvents();
+  }
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
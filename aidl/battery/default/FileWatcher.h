@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Watches a single file with inotify, on a thread of its own.
+ *
+ * The parent directory is watched rather than the file, so creating the
+ * file, replacing it (e.g. adb push, editors renaming a temporary copy)
+ * and removing it are all seen. Bursts of events are coalesced into one
+ * callback once the file was left alone for a moment.
+ */
+class FileWatcher {
+public:
+  using Callback = std::function<void(void)>;
+
+  /**
+   * Start watching, returns null on failure.
+   *
+   * @param path File to watch, its directory must exist
+   * @param onChange Called from the watcher thread after the file was
+   *                 written, replaced or removed
+   */
+  static std::unique_ptr<FileWatcher> watch(const std::string &path, Callback onChange);
+
+  FileWatcher(::android::base::unique_fd inotifyFd, ::android::base::unique_fd wakeFd,
+              std::string name, Callback onChange);
+  // Stops and joins the watcher thread
+  ~FileWatcher();
+
+private:
+  void watchLoop(void);
+  // Drain pending events, returns true if any was about the file
+  bool readEvents(void);
+
+  ::android::base::unique_fd mInotifyFd;
+  // eventfd to stop the thread
+  ::android::base::unique_fd mWakeFd;
+  // File name within the watched directory
+  std::string mName;
+  Callback mOnChange;
+  std::thread mThread;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
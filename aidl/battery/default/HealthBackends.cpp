@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "SmartChargeSvc::HealthBackends"
+
+#include "HealthBackends.h"
+
+#include <aidl/android/hardware/health/BnHealthInfoCallback.h>
+#include <android/hardware/health/2.0/IHealthInfoCallback.h>
+
+#include <SafeStoi.h>
+#include <log/log.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using ::android::sp;
+using ::android::base::unique_fd;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+
+// Returns false if status is neither charging nor discharging
+template <typename T>
+static bool toChargeStatus(const T status, ChargeStatus *out) {
+  switch (status) {
+  case T::CHARGING:
+  case T::FULL:
+    *out = ChargeStatus::ON;
+    return true;
+  case T::DISCHARGING:
+  case T::NOT_CHARGING:
+    *out = ChargeStatus::OFF;
+    return true;
+  default:
+    return false;
+  };
+}
+
+template <typename T>
+static HealthSample toHealthSample(const int capacity, const T status,
+                                   const bool chargerOnline) {
+  HealthSample sample = {};
+  sample.capacity = capacity;
+  sample.statusKnown = toChargeStatus(status, &sample.status);
+  sample.chargerKnown = true;
+  sample.chargerOnline = chargerOnline;
+  return sample;
+}
+
+template <typename T> static bool isChargerOnline(const T &info) {
+  return info.chargerAcOnline || info.chargerUsbOnline || info.chargerWirelessOnline;
+}
+
+// AIDL
+namespace {
+class aidl_health_info_callback
+    : public aidl::android::hardware::health::BnHealthInfoCallback {
+public:
+  explicit aidl_health_info_callback(HealthSource::Listener listener)
+      : mListener(std::move(listener)) {}
+  ndk::ScopedAStatus
+  healthInfoChanged(const aidl::android::hardware::health::HealthInfo &info) override {
+    mListener(toHealthSample(info.batteryLevel, info.batteryStatus,
+                             isChargerOnline(info) || info.chargerDockOnline));
+    return ndk::ScopedAStatus::ok();
+  }
+
+private:
+  HealthSource::Listener mListener;
+};
+} // namespace
+
+AidlHealthSource::AidlHealthSource(std::shared_ptr<IHealth> health)
+    : mHealth(std::move(health)) {}
+
+AidlHealthSource::~AidlHealthSource() {
+  if (mCallback)
+    mHealth->unregisterCallback(mCallback);
+}
+
+int AidlHealthSource::read(HealthSample *out) {
+  aidl::android::hardware::health::HealthInfo info;
+  auto ret = mHealth->getHealthInfo(&info);
+  if (!ret.isOk())
+    return ret.getStatus() < 0 ? ret.getStatus() : -EIO;
+  *out = toHealthSample(info.batteryLevel, info.batteryStatus,
+                        isChargerOnline(info) || info.chargerDockOnline);
+  return 0;
+}
+
+bool AidlHealthSource::registerListener(Listener listener) {
+  auto callback =
+      ndk::SharedRefBase::make<aidl_health_info_callback>(std::move(listener));
+  auto ret = mHealth->registerCallback(callback);
+  if (!ret.isOk()) {
+    ALOGW("%s: registerCallback: %s", __func__, ret.getDescription().c_str());
+    return false;
+  }
+  mCallback = std::move(callback);
+  return true;
+}
+
+// HIDL
+namespace {
+class hidl_health_info_callback : public HidlHealthSource::IHealthInfoCallback {
+public:
+  explicit hidl_health_info_callback(HealthSource::Listener listener)
+      : mListener(std::move(listener)) {}
+  Return<void>
+  healthInfoChanged(const ::android::hardware::health::V2_0::HealthInfo &info) override {
+    mListener(toHealthSample(info.legacy.batteryLevel, info.legacy.batteryStatus,
+                             isChargerOnline(info.legacy)));
+    return Void();
+  }
+
+private:
+  HealthSource::Listener mListener;
+};
+} // namespace
+
+HidlHealthSource::HidlHealthSource(sp<IHealth> health)
+    : mHealth(std::move(health)) {}
+
+HidlHealthSource::~HidlHealthSource() {
+  if (mCallback != nullptr)
+    mHealth->unregisterCallback(mCallback);
+}
+
+int HidlHealthSource::read(HealthSample *out) {
+  using ::android::hardware::health::V2_0::HealthInfo;
+  using ::android::hardware::health::V2_0::Result;
+
+  Result res = Result::UNKNOWN;
+  auto ret = mHealth->getHealthInfo([&res, out](Result hal_res, const HealthInfo &info) {
+    res = hal_res;
+    if (res == Result::SUCCESS)
+      *out = toHealthSample(info.legacy.batteryLevel, info.legacy.batteryStatus,
+                            isChargerOnline(info.legacy));
+  });
+  if (!ret.isOk())
+    return -EIO;
+  if (res != Result::SUCCESS)
+    return -(static_cast<int>(res));
+  return 0;
+}
+
+bool HidlHealthSource::registerListener(Listener listener) {
+  using ::android::hardware::health::V2_0::Result;
+
+  sp<IHealthInfoCallback> callback = new hidl_health_info_callback(std::move(listener));
+  auto ret = mHealth->registerCallback(callback);
+  if (!ret.isOk() || Result(ret) != Result::SUCCESS) {
+    ALOGW("%s: registerCallback failed", __func__);
+    return false;
+  }
+  mCallback = std::move(callback);
+  return true;
+}
+
+// sysfs
+static int readNode(const int fd, char *buf, const size_t len) {
+  ssize_t n = TEMP_FAILURE_RETRY(pread(fd, buf, len - 1, 0));
+  if (n < 0)
+    return -errno;
+  // Strip trailing newline
+  while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' '))
+    --n;
+  buf[n] = '\0';
+  return n;
+}
+
+// online nodes of the chargers next to the battery at dir, e.g. usb and ac
+static std::vector<unique_fd> openChargerNodes(const std::string &dir) {
+  const std::string parent = dir.substr(0, dir.rfind('/'));
+  const std::string battery = dir.substr(dir.rfind('/') + 1);
+  std::vector<unique_fd> fds;
+  char type[32];
+
+  DIR *d = opendir(parent.c_str());
+  if (d == nullptr)
+    return fds;
+  while (struct dirent *entry = readdir(d)) {
+    const std::string base = parent + "/" + entry->d_name;
+    if (entry->d_name[0] == '.' || battery == entry->d_name)
+      continue;
+    unique_fd typeFd(::open((base + "/type").c_str(), O_RDONLY | O_CLOEXEC));
+    // Fuel gauges and the like have online nodes too
+    if (typeFd < 0 || readNode(typeFd, type, sizeof(type)) < 0 ||
+        std::string_view(type) == "Battery")
+      continue;
+    unique_fd online(::open((base + "/online").c_str(), O_RDONLY | O_CLOEXEC));
+    if (online >= 0)
+      fds.push_back(std::move(online));
+  }
+  closedir(d);
+  return fds;
+}
+
+std::unique_ptr<SysfsHealthSource> SysfsHealthSource::open(const std::string &dir) {
+  unique_fd capacity(::open((dir + "/capacity").c_str(), O_RDONLY | O_CLOEXEC));
+  unique_fd status(::open((dir + "/status").c_str(), O_RDONLY | O_CLOEXEC));
+  if (capacity < 0 || status < 0) {
+    ALOGD("%s: power_supply nodes under %s unavailable: %s", __func__,
+          dir.c_str(), strerror(errno));
+    return nullptr;
+  }
+  std::unique_ptr<SysfsHealthSource> source(new SysfsHealthSource(
+      std::move(capacity), std::move(status), openChargerNodes(dir)));
+  HealthSample sample;
+  if (source->read(&sample) < 0)
+    return nullptr;
+  return source;
+}
+
+int SysfsHealthSource::read(HealthSample *out) {
+  char buf[32];
+  int rc;
+
+  rc = readNode(mCapacityFd, buf, sizeof(buf));
+  if (rc < 0)
+    return rc;
+  out->capacity = stoi_safe(buf);
+  if (out->capacity < 0)
+    return -EINVAL;
+
+  rc = readNode(mStatusFd, buf, sizeof(buf));
+  if (rc < 0)
+    return rc;
+  const std::string_view status(buf);
+  out->statusKnown = true;
+  if (status == "Charging" || status == "Full")
+    out->status = ChargeStatus::ON;
+  else if (status == "Discharging" || status == "Not charging")
+    out->status = ChargeStatus::OFF;
+  else
+    out->statusKnown = false;
+
+  // Unknown if no charger node could be read
+  out->chargerKnown = false;
+  out->chargerOnline = false;
+  for (const auto &fd : mChargerFds) {
+    if (readNode(fd, buf, sizeof(buf)) < 0)
+      continue;
+    out->chargerKnown = true;
+    out->chargerOnline |= stoi_safe(buf) > 0;
+  }
+  return 0;
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
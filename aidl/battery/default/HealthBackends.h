@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "HealthSource.h"
+
+#include <aidl/android/hardware/health/BnHealth.h>
+#include <healthhalutils/HealthHalUtils.h>
+#include <android-base/unique_fd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+// Health AIDL HAL, one getHealthInfo transaction per sample
+class AidlHealthSource : public HealthSource {
+public:
+  using IHealth = aidl::android::hardware::health::IHealth;
+  using IHealthInfoCallback = aidl::android::hardware::health::IHealthInfoCallback;
+
+  explicit AidlHealthSource(std::shared_ptr<IHealth> health);
+  ~AidlHealthSource() override;
+  int read(HealthSample *out) override;
+  bool registerListener(Listener listener) override;
+  const char *getName(void) const override { return "AIDL Health HAL V1"; }
+
+private:
+  std::shared_ptr<IHealth> mHealth;
+  std::shared_ptr<IHealthInfoCallback> mCallback;
+};
+
+// Health HIDL V2.0 HAL, one getHealthInfo transaction per sample
+class HidlHealthSource : public HealthSource {
+public:
+  using IHealth = ::android::hardware::health::V2_0::IHealth;
+  using IHealthInfoCallback = ::android::hardware::health::V2_0::IHealthInfoCallback;
+
+  explicit HidlHealthSource(::android::sp<IHealth> health);
+  ~HidlHealthSource() override;
+  int read(HealthSample *out) override;
+  bool registerListener(Listener listener) override;
+  const char *getName(void) const override { return "HIDL Health HAL V2.0"; }
+
+private:
+  ::android::sp<IHealth> mHealth;
+  ::android::sp<IHealthInfoCallback> mCallback;
+};
+
+// Reads power_supply sysfs nodes directly, no binder involved
+class SysfsHealthSource : public HealthSource {
+public:
+  static constexpr const char *kDefaultPath = "/sys/class/power_supply/battery";
+
+  // Returns null if capacity or status node cannot be read
+  static std::unique_ptr<SysfsHealthSource> open(const std::string &dir = kDefaultPath);
+
+  int read(HealthSample *out) override;
+  const char *getName(void) const override { return "sysfs power_supply"; }
+
+private:
+  SysfsHealthSource(::android::base::unique_fd capacity,
+                    ::android::base::unique_fd status,
+                    std::vector<::android::base::unique_fd> chargers)
+      : mCapacityFd(std::move(capacity)), mStatusFd(std::move(status)),
+        mChargerFds(std::move(chargers)) {}
+
+  ::android::base::unique_fd mCapacityFd;
+  ::android::base::unique_fd mStatusFd;
+  // online nodes of the chargers, e.g. usb and ac
+  std::vector<::android::base::unique_fd> mChargerFds;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "HealthSource.h"
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using ScopedLock = const std::lock_guard<std::mutex>;
+
+// Fake
+void FakeHealthSource::setSample(const HealthSample &sample) {
+  Listener listener;
+  {
+    ScopedLock _(mLock);
+    mSample = sample;
+    listener = mListener;
+  }
+  if (listener)
+    listener(sample);
+}
+
+void FakeHealthSource::setError(const int error) {
+  ScopedLock _(mLock);
+  mError = error;
+}
+
+int FakeHealthSource::read(HealthSample *out) {
+  ScopedLock _(mLock);
+  if (mError < 0)
+    return mError;
+  *out = mSample;
+  return 0;
+}
+
+bool FakeHealthSource::registerListener(Listener listener) {
+  ScopedLock _(mLock);
+  mListener = std::move(listener);
+  return true;
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
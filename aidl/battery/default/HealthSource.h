@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+enum ChargeStatus {
+  ON,
+  OFF,
+};
+
+struct HealthSample {
+  int capacity;
+  // False if the battery is neither charging nor discharging
+  bool statusKnown;
+  ChargeStatus status;
+  // False if the backend cannot tell whether a charger is plugged in
+  bool chargerKnown;
+  bool chargerOnline;
+};
+
+/**
+ * Where SmartCharge gets battery capacity and charge status from.
+ */
+class HealthSource {
+public:
+  using Listener = std::function<void(const HealthSample &)>;
+
+  virtual ~HealthSource() = default;
+
+  /**
+   * Take one sample.
+   *
+   * @param out Sample to fill in
+   * @return 0 on success, negative error code otherwise
+   */
+  virtual int read(HealthSample *out) = 0;
+
+  /**
+   * Ask the backend to push samples whenever they change.
+   *
+   * @return false if the backend cannot push, the caller has to poll then
+   */
+  virtual bool registerListener(Listener /* listener */) { return false; }
+
+  // Human readable name of the backend, for dump()
+  virtual const char *getName(void) const = 0;
+};
+
+// Returns whatever was set last, pushing every update to the listener.
+class FakeHealthSource : public HealthSource {
+public:
+  void setSample(const HealthSample &sample);
+  // Make read() fail with error (negative), 0 to recover
+  void setError(const int error);
+
+  int read(HealthSample *out) override;
+  bool registerListener(Listener listener) override;
+  const char *getName(void) const override { return "fake"; }
+
+private:
+  HealthSample mSample = {};
+  int mError = 0;
+  Listener mListener;
+  std::mutex mLock;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -3,66 +3,41 @@
 #include "JSONParser.hpp"
 #include <android-base/logging.h>
 
-#include <initializer_list>
+#include <algorithm>
 #include <fstream>
-#include <functional>
-#include <map>
+#include <iterator>
 #include <string>
 #include <vector>
 
-void ConfigParser::handler_OpenFile(const std::string &node,
-                                    const std::string &data) {
-  LOG(DEBUG) << "Opening file: " << data;
-  std::ifstream file(node);
-  std::string line;
-
-  if (file) {
-    file >> line;
-  } else {
-    PLOG(ERROR) << "Failed to read file";
+void ConfigParser::buildIndex(void) {
+  if (!root.isArray()) {
+    LOG(ERROR) << "Root is not an array";
+    return;
   }
-}
-
-void ConfigParser::handler_WriteFile(const std::string &node,
-                                     const std::string &data) {
-  LOG(DEBUG) << "Writing to file: " << data;
-  std::ofstream file(node);
-  if (file) {
-    file << data;
-  } else {
-    PLOG(ERROR) << "Failed to write to file";
+  for (Json::ArrayIndex i = 0; i < root.size(); ++i) {
+    const Json::Value &device = root[i];
+    const Json::Value &codename = device["codename"];
+    const Json::Value &vendor = device["vendor"];
+    if (codename.isString())
+      m_codenameIndex.emplace(codename.asString(), i);
+    if (vendor.isString())
+      m_vendorIndex.insert_or_assign(vendor.asString(), i);
   }
 }
 
 // Returns a pair with the matching device and its match quality.
-std::pair<Json::Value, ConfigParser::MatchQuality>
-ConfigParser::lookupEntry(const SearchEntry &search) {
-  std::pair<Json::Value, MatchQuality> current = {root, MatchQuality::NO_MATCH};
-  for (const auto &devices : root) {
-    if (devices["codename"].asString() == search.codename) {
-      current = {devices, MatchQuality::EXACT};
-      break;
-    }
-    if (devices["vendor"].asString() == search.vendor) {
-      current = {devices, MatchQuality::MATCHES_VENDOR};
-    }
+std::pair<const Json::Value *, ConfigParser::MatchQuality>
+ConfigParser::lookupEntry(const SearchEntry &search) const {
+  if (auto it = m_codenameIndex.find(search.codename); it != m_codenameIndex.end()) {
+    LOG(DEBUG) << "Found a match with quality: EXACT";
+    return {&root[it->second], MatchQuality::EXACT};
   }
-  if (current.second == MatchQuality::NO_MATCH) {
-    LOG(ERROR) << "No matching device found";
-    return current;
+  if (auto it = m_vendorIndex.find(search.vendor); it != m_vendorIndex.end()) {
+    LOG(DEBUG) << "Found a match with quality: MATCHES_VENDOR";
+    return {&root[it->second], MatchQuality::MATCHES_VENDOR};
   }
-  LOG(DEBUG) << "Found a match with quality: ";
-  switch (current.second) {
-  case MatchQuality::EXACT:
-    LOG(DEBUG) << "EXACT";
-    break;
-  case MatchQuality::MATCHES_VENDOR:
-    LOG(DEBUG) << "MATCHES_VENDOR";
-    break;
-  case MatchQuality::NO_MATCH:
-    break;
-  };
-  return current;
+  LOG(ERROR) << "No matching device found";
+  return {nullptr, MatchQuality::NO_MATCH};
 }
 
 ConfigParser::ConfigParser(const std::string &path) {
@@ -72,67 +47,67 @@ ConfigParser::ConfigParser(const std::string &path) {
     return;
   }
   file >> root;
+  buildIndex();
 }
 
-std::function<void(bool)> ConfigParser::findEntry(const SearchEntry &search) {
-  constexpr int ENABLE_FN_INDEX = 0;
-  constexpr int DISABLE_FN_INDEX = 1;
-  std::array<std::function<void(void)>, 2> handlers;
-
+std::unique_ptr<ConfigParser::ActionPlan>
+ConfigParser::findEntry(const SearchEntry &search) {
   const auto current = lookupEntry(search);
   if (current.second == MatchQuality::NO_MATCH) {
-    return [](bool) {};
+    return nullptr;
   }
 
-  for (const auto &action : current.first["actions"]) {
+  auto plan = std::make_unique<ActionPlan>();
+  for (const auto &action : (*current.first)["actions"]) {
     if (!action["action"].isString()) {
       LOG(ERROR) << "Invalid action type";
-      return [](bool) {};
+      return nullptr;
     }
     const std::string actionType = action["action"].asString();
     const std::string node = action["node"].asString();
     const std::string handlerName = action["handler"].asString();
     const std::string handlerData = action["handler_data"].asString();
+    bool enable;
 
-    if (actionType == "enable") {
-      for (const auto &handler : m_handlers) {
-        if (handler.first == handlerName) {
-          handlers[ENABLE_FN_INDEX] = [callback = handler.second, node,
-                                       handlerData]() {
-            callback(node, handlerData);
-          };
-          break;
-        }
-      }
-      if (!handlers[ENABLE_FN_INDEX]) {
-        LOG(ERROR) << "No handlers found for enable action";
-        return [](bool) {};
+    if (actionType == "offload") {
+      // Cap is written as its level, handler_data lifts it
+      std::vector<int> levels;
+      if (handlerName != "WriteFile" || !action["levels"].isArray()) {
+        LOG(ERROR) << "Invalid offload action";
+        return nullptr;
       }
-    } else if (actionType == "disable") {
-      for (const auto &handler : m_handlers) {
-        if (handler.first == handlerName) {
-          handlers[DISABLE_FN_INDEX] = [callback = handler.second, node,
-                                        handlerData]() {
-            callback(node, handlerData);
-          };
-          break;
+      for (const auto &level : action["levels"]) {
+        if (!level.isInt()) {
+          LOG(ERROR) << "Invalid offload level";
+          return nullptr;
         }
+        levels.push_back(level.asInt());
       }
-      if (!handlers[DISABLE_FN_INDEX]) {
-        LOG(ERROR) << "No handlers found for disable action";
-        return [](bool) {};
-      }
+      plan->setOffload(node, levels, handlerData);
+      continue;
+    }
+    if (actionType == "enable") {
+      enable = true;
+    } else if (actionType == "disable") {
+      enable = false;
     } else {
       LOG(ERROR) << "Invalid action type";
-      return [](bool) {};
+      return nullptr;
     }
-  }
-  return [handlers](bool enable) {
-    if (enable) {
-      handlers[ENABLE_FN_INDEX]();
-    } else {
-      handlers[DISABLE_FN_INDEX]();
+    auto handler = std::find_if(
+        std::begin(m_handlers), std::end(m_handlers),
+        [&handlerName](const HandlerType &h) { return handlerName == h.first; });
+    if (handler == std::end(m_handlers)) {
+      LOG(ERROR) << "No handlers found for " << actionType << " action";
+      return nullptr;
     }
-  };
+    plan->setAction(enable, handler->second, node, handlerData);
+  }
+  if (!plan->isComplete()) {
+    LOG(ERROR) << "Missing enable or disable action";
+    return nullptr;
+  }
+  plan->setMatch(current.second == MatchQuality::EXACT ? "codename:" + search.codename
+                                                       : "vendor:" + search.vendor);
+  return plan;
 }
-
@@ -1,38 +1,41 @@
 #include <json/json.h>
-#include <functional>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "ActionPlan.h"
 
 class ConfigParser {
 public:
   struct SearchEntry;
 
 private:
-  Json::Value root;
-  struct Handler {
-    std::function<void(const std::string &, const std::string &)> handler;
-    std::string name;
-  };
+  using ActionPlan = aidl::vendor::samsung_ext::framework::battery::ActionPlan;
 
-  static void handler_OpenFile(const std::string &node,
-                               const std::string &data);
-
-  static void handler_WriteFile(const std::string &node,
-                                const std::string &data);
+  Json::Value root;
 
-  // Takes a node path and data
-  using HandlerFunction =
-      std::function<void(const std::string &, const std::string &)>;
-  // Takes name and handler function
-  using HandlerType = std::pair<std::string, HandlerFunction>;
+  // Takes name and the handler it compiles to
+  using HandlerType = std::pair<const char *, ActionPlan::Handler>;
 
-  std::vector<HandlerType> m_handlers = {
-      {"OpenFile", handler_OpenFile},
-      {"WriteFile", handler_WriteFile},
+  static constexpr HandlerType m_handlers[] = {
+      {"OpenFile", ActionPlan::Handler::OPEN_FILE},
+      {"WriteFile", ActionPlan::Handler::WRITE_FILE},
   };
 
   enum class MatchQuality { EXACT, MATCHES_VENDOR, NO_MATCH };
 
-  // Returns a pair with the matching device and its match quality.
-  std::pair<Json::Value, MatchQuality> lookupEntry(const SearchEntry &search);
+  // Index into root by codename (first entry wins) and vendor (last entry
+  // wins), same precedence as a linear scan would give.
+  std::unordered_map<std::string, Json::ArrayIndex> m_codenameIndex;
+  std::unordered_map<std::string, Json::ArrayIndex> m_vendorIndex;
+  void buildIndex(void);
+
+  // Returns a pair with the matching device, pointing into root, and its
+  // match quality. The device is null if nothing matched.
+  std::pair<const Json::Value *, MatchQuality>
+  lookupEntry(const SearchEntry &search) const;
 
 public:
   ConfigParser(const std::string &path);
@@ -42,5 +45,6 @@ public:
     std::string vendor;
   };
 
-  std::function<void(bool)> findEntry(const SearchEntry &search);
+  // Returns compiled actions of the matching device, null if none matches
+  std::unique_ptr<ActionPlan> findEntry(const SearchEntry &search);
 };
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "SmartChargeSvc::NodeProber"
+
+#include "NodeProber.h"
+#include "DeviceDatabase.h"
+
+#include <android-base/unique_fd.h>
+#include <log/log.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <vector>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using ::android::base::unique_fd;
+
+namespace {
+
+struct Candidate {
+  const char *name;
+  CompiledAction enable;
+  CompiledAction disable;
+};
+
+constexpr auto kWrite = ActionPlan::Handler::WRITE_FILE;
+constexpr auto kOpen = ActionPlan::Handler::OPEN_FILE;
+
+// In order of preference, first working one wins
+constexpr Candidate kCandidates[] = {
+    {"batt_slate_mode",
+     {true, kWrite, "/sys/class/power_supply/battery/batt_slate_mode", "0"},
+     {false, kWrite, "/sys/class/power_supply/battery/batt_slate_mode", "1"}},
+    {"input_suspend",
+     {true, kWrite, "/sys/class/power_supply/battery/input_suspend", "0"},
+     {false, kWrite, "/sys/class/power_supply/battery/input_suspend", "1"}},
+    {"qcom_input_suspend",
+     {true, kWrite, "/sys/class/qcom-battery/input_suspend", "0"},
+     {false, kWrite, "/sys/class/qcom-battery/input_suspend", "1"}},
+    {"charging_enabled",
+     {true, kWrite, "/sys/class/power_supply/battery/charging_enabled", "1"},
+     {false, kWrite, "/sys/class/power_supply/battery/charging_enabled", "0"}},
+    {"battery_charging_enabled",
+     {true, kWrite, "/sys/class/power_supply/battery/battery_charging_enabled", "1"},
+     {false, kWrite, "/sys/class/power_supply/battery/battery_charging_enabled", "0"}},
+    {"StopCharging_Test",
+     {true, kOpen, "/sys/class/power_supply/battery/StartCharging_Test", ""},
+     {false, kOpen, "/sys/class/power_supply/battery/StopCharging_Test", ""}},
+};
+
+} // namespace
+
+// Without side effects, nothing is written and trigger nodes are not read
+static bool probeAction(const CompiledAction &action, const Candidate &candidate) {
+  char buf[16];
+
+  if (action.handler == kOpen)
+    return access(action.node, R_OK) == 0;
+
+  unique_fd fd(open(action.node, O_RDWR | O_CLOEXEC));
+  if (fd < 0)
+    return false;
+  const ssize_t n = TEMP_FAILURE_RETRY(read(fd, buf, sizeof(buf) - 1));
+  if (n <= 0)
+    return false;
+  // Node must hold one of the values it is going to be written
+  std::string value(buf, n);
+  while (!value.empty() && isspace(static_cast<unsigned char>(value.back())))
+    value.pop_back();
+  return value == candidate.enable.data || value == candidate.disable.data;
+}
+
+static bool probeCandidate(const Candidate &candidate) {
+  return probeAction(candidate.enable, candidate) &&
+         probeAction(candidate.disable, candidate);
+}
+
+static std::unique_ptr<ActionPlan> makePlan(const Candidate &candidate, const bool cached) {
+  auto plan = std::make_unique<ActionPlan>();
+
+  for (const auto *action : {&candidate.enable, &candidate.disable})
+    plan->setAction(action->enable, action->handler, action->node, action->data);
+  plan->setMatch(std::string("probe:") + candidate.name + (cached ? " (cached)" : ""));
+  return plan;
+}
+
+// Returns null on a cache miss
+static const Candidate *loadCache(const std::string &cachePath, const std::string &fingerprint) {
+  std::ifstream file(cachePath);
+  std::string cachedFingerprint, name;
+
+  if (!std::getline(file, cachedFingerprint) || cachedFingerprint != fingerprint)
+    return nullptr;
+  if (!std::getline(file, name))
+    return nullptr;
+  for (const auto &candidate : kCandidates) {
+    if (name == candidate.name)
+      return &candidate;
+  }
+  // Candidate no longer in the catalogue, or an old cache of finding none
+  return nullptr;
+}
+
+static void storeCache(const std::string &cachePath, const std::string &fingerprint,
+                       const Candidate &winner) {
+  const std::string tmpPath = cachePath + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::trunc);
+    file << fingerprint << '\n' << winner.name << '\n';
+    if (!file.flush()) {
+      ALOGW("%s: Failed to write %s", __func__, tmpPath.c_str());
+      return;
+    }
+  }
+  // Never leave a torn cache behind
+  if (rename(tmpPath.c_str(), cachePath.c_str()) < 0)
+    ALOGW("%s: rename: %s", __func__, strerror(errno));
+}
+
+std::unique_ptr<ActionPlan> probeChargeControl(const std::string &cachePath,
+                                               const std::string &fingerprint) {
+  const Candidate *winner = nullptr;
+  std::vector<std::future<bool>> results;
+
+  if (!fingerprint.empty())
+    winner = loadCache(cachePath, fingerprint);
+  if (winner != nullptr) {
+    ALOGD("%s: Cached outcome: %s", __func__, winner->name);
+    return makePlan(*winner, true);
+  }
+
+  // Some drivers take their time answering, do not add their latencies up
+  for (const auto &candidate : kCandidates)
+    results.push_back(std::async(std::launch::async, probeCandidate, std::cref(candidate)));
+  for (size_t i = 0; i < results.size(); ++i) {
+    const bool works = results[i].get();
+    ALOGD("%s: %s: %s", __func__, kCandidates[i].name, works ? "works" : "unavailable");
+    if (works && winner == nullptr)
+      winner = &kCandidates[i];
+  }
+
+  // Not finding any is not cached, their drivers may just register late
+  if (winner == nullptr) {
+    ALOGW("%s: No charge control node found", __func__);
+    return nullptr;
+  }
+  if (!fingerprint.empty())
+    storeCache(cachePath, fingerprint, *winner);
+  ALOGI("%s: Using %s", __func__, winner->name);
+  return makePlan(*winner, false);
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "ActionPlan.h"
+
+#include <memory>
+#include <string>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Find charge control nodes of a device without an entry in
+ * smartcharge_nodes.json, from a catalogue of well known ones.
+ *
+ * Candidates are probed concurrently and without side effects: nodes must
+ * exist and be accessible, and nodes taking a payload must read back one
+ * of its values. The first working candidate in catalogue order wins.
+ * The winner is cached per build fingerprint, so only the first boot of a
+ * build pays for probing. Finding none is not cached, as nodes may show up
+ * late, and is probed again on the next call.
+ *
+ * @param cachePath File to keep the outcome in
+ * @param fingerprint Build fingerprint, e.g. ro.build.fingerprint
+ * @return Actions of the winning candidate, null if none works
+ */
+std::unique_ptr<ActionPlan> probeChargeControl(const std::string &cachePath,
+                                               const std::string &fingerprint);
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "SmartChargeSvc::Reactor"
+
+#include "Reactor.h"
+
+#include <log/log.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+// Events handled per epoll_wait, more are simply picked up by the next one
+static constexpr int kMaxEvents = 8;
+
+Reactor::Reactor() {
+  mEpollFd.reset(epoll_create1(EPOLL_CLOEXEC));
+  if (mEpollFd < 0)
+    LOG_ALWAYS_FATAL("Failed to create epoll: %s", strerror(errno));
+  mStopFd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+  if (mStopFd < 0)
+    LOG_ALWAYS_FATAL("Failed to create eventfd: %s", strerror(errno));
+
+  // Null data marks the stop fd
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.ptr = nullptr;
+  if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mStopFd, &ev) < 0)
+    LOG_ALWAYS_FATAL("Failed to watch eventfd: %s", strerror(errno));
+}
+
+Reactor::~Reactor() { stop(); }
+
+bool Reactor::add(const int fd, const uint32_t events, Handler handler) {
+  auto entry = std::make_unique<Entry>(Entry{fd, std::move(handler), false});
+  struct epoll_event ev = {};
+
+  ev.events = events;
+  ev.data.ptr = entry.get();
+  if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    ALOGE("%s: epoll_ctl: %s", __func__, strerror(errno));
+    return false;
+  }
+  mEntries.push_back(std::move(entry));
+  return true;
+}
+
+void Reactor::remove(const int fd) {
+  for (auto &entry : mEntries) {
+    if (entry->removed || entry->fd != fd)
+      continue;
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+    entry->removed = true;
+  }
+}
+
+void Reactor::sweep(void) {
+  mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(),
+                                [](const auto &entry) { return entry->removed; }),
+                 mEntries.end());
+}
+
+void Reactor::start(void) {
+  mThread = std::thread(&Reactor::run, this);
+}
+
+void Reactor::stop(void) {
+  if (!mThread.joinable())
+    return;
+  uint64_t val = 1;
+  TEMP_FAILURE_RETRY(write(mStopFd, &val, sizeof(val)));
+  mThread.join();
+}
+
+void Reactor::run(void) {
+  struct epoll_event events[kMaxEvents];
+
+  while (true) {
+    const int n = TEMP_FAILURE_RETRY(epoll_wait(mEpollFd, events, kMaxEvents, -1));
+    if (n < 0)
+      LOG_ALWAYS_FATAL("epoll_wait: %s", strerror(errno));
+    for (int i = 0; i < n; ++i) {
+      auto *entry = static_cast<Entry *>(events[i].data.ptr);
+      if (entry == nullptr)
+        return;
+      // Removed by an earlier handler of this batch
+      if (entry->removed)
+        continue;
+      entry->handler(events[i].events);
+    }
+    // E.g. uevent is reopened on every offload cycle, do not pile up
+    sweep();
+  }
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Single thread dispatching epoll events to per-fd handlers.
+ *
+ * Everything the service reacts to (timers, uevents, eventfd wakeups)
+ * is an fd on one reactor, so the service needs no thread per task and
+ * handlers never run concurrently with each other.
+ */
+class Reactor {
+public:
+  // Gets the epoll events of the fd, e.g. EPOLLIN
+  using Handler = std::function<void(uint32_t events)>;
+
+  Reactor();
+  // Stops the thread if still running
+  ~Reactor();
+
+  /**
+   * Watch an fd, level triggered. Only call before start() or from a
+   * handler, the fd must stay open until removed.
+   *
+   * @return false if epoll refused the fd
+   */
+  bool add(const int fd, const uint32_t events, Handler handler);
+  // Stop watching an fd, same constraints as add()
+  void remove(const int fd);
+
+  void start(void);
+  // Wake the thread up and join it, handlers are not called afterwards
+  void stop(void);
+
+private:
+  struct Entry {
+    int fd;
+    Handler handler;
+    // Freed once the current batch is dispatched, a removed handler may
+    // still be running or have events pending in it
+    bool removed;
+  };
+
+  void run(void);
+  // Free removed entries, no handler may be running
+  void sweep(void);
+
+  ::android::base::unique_fd mEpollFd;
+  // eventfd to stop the thread
+  ::android::base::unique_fd mStopFd;
+  std::vector<std::unique_ptr<Entry>> mEntries;
+  std::thread mThread;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
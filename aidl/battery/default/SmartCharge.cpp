@@ -5,18 +5,30 @@
  */
 
 #include "SmartCharge.h"
+#include "DeviceDatabase.h"
 #include "JSONParser.hpp"
+#include "NodeProber.h"
 
 #include <GetServiceSupport.h>
 #include <SafeStoi.h>
 
+#include <android-base/chrono_utils.h>
 #include <android-base/logging.h>
 #include <android-base/properties.h>
 #include <hidl/HidlTransportSupport.h>
 #include <log/log.h>
 
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cerrno>
 #include <chrono>
+#include <cstring>
+#include <ctime>
 #include <functional>
+#include <algorithm>
 #include <sstream>
 #include <type_traits>
 
@@ -26,8 +38,10 @@ namespace samsung_ext {
 namespace framework {
 namespace battery {
 
+using ::android::base::GetBoolProperty;
 using ::android::base::GetProperty;
 using ::android::base::SetProperty;
+using ::android::base::unique_fd;
 
 using ScopedLock = const std::lock_guard<std::mutex>;
 
@@ -37,15 +51,37 @@ static constexpr int kInvalidCfg = -1;
 
 static const char kSmartChargeConfigProp[] = "persist.ext.smartcharge.config";
 static const char kSmartChargeEnabledProp[] = "persist.ext.smartcharge.enabled";
+static const char kSmartChargeUeventProp[] = "persist.ext.smartcharge.uevent";
+static const char kSmartChargeScheduleProp[] = "persist.ext.smartcharge.schedule";
+// Development copy of smartcharge_nodes.json, used over the compiled table
+// on debuggable builds
+static const char kNodesOverridePath[] = "/data/local/tmp/smartcharge_nodes.json";
+// Outcome of probing for devices not in smartcharge_nodes.json, created by rc
+static const char kProbeCachePath[] = "/data/misc/smartcharge/probe_cache";
 static const char kComma = ',';
 
+// Backoff of health HAL connection attempts
+static constexpr auto kConnectRetryMin = 1s;
+static constexpr auto kConnectRetryMax = 1min;
+// Loop wakeup while no health sample was ever taken, connecting wakes it too
+static constexpr auto kHealthConnectWait = 1min;
+// Longest the schedule timer waits with a schedule set, so a zone change
+// is caught up with even if nothing else wakes the loop
+static constexpr auto kScheduleRecheck = 1h;
+
+static std::chrono::nanoseconds threadCpuTime(void) {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
 template <typename T>
 using is_integral_or_bool =
     std::enable_if_t<std::is_integral_v<T> || std::is_same_v<T, bool>, bool>;
 
 static inline bool isValidBool(const int val) { return val == !!val; }
 static inline bool verifyConfig(const int lower, const int upper) {
-  return !(upper <= lower || upper > 95 || (0 <= lower && lower < 50));
+  return verifyChargeLimits(lower, upper);
 }
 
 template <typename T, is_integral_or_bool<T> = true> struct ConfigPair {
@@ -95,29 +131,65 @@ static void onServiceDied(void *cookie) {
   reinterpret_cast<SmartCharge *>(cookie)->loadHealthImpl();
 }
 
+void SmartCharge::onHealthInfoChanged(const HealthSample &sample) {
+  {
+    ScopedLock _(pushed_info_lock);
+    if (pushedInfo.valid && pushedInfo.sample.capacity == sample.capacity &&
+        pushedInfo.sample.statusKnown == sample.statusKnown &&
+        pushedInfo.sample.status == sample.status &&
+        pushedInfo.sample.chargerKnown == sample.chargerKnown &&
+        pushedInfo.sample.chargerOnline == sample.chargerOnline)
+      return;
+    pushedInfo.valid = true;
+    pushedInfo.sample = sample;
+  }
+  // Firmware holds the limit, picked up once the loop takes over again
+  if (offloaded)
+    return;
+  // Let the loop re-evaluate with new info
+  wakeLoop();
+}
+
 void SmartCharge::loadHealthImpl(void) {
-  bool linkToDeathSuccess;
+  ScopedLock _(health_connect_lock);
+  healthReconnect = true;
+  // Picked up by the running attempt
+  if (healthConnecting || healthConnectStop)
+    return;
+  // The last attempt is over, only its thread is left to reap
+  if (health_connect_thread.joinable())
+    health_connect_thread.join();
+  healthConnecting = true;
+  health_connect_thread = std::thread(&SmartCharge::healthConnectLoop, this);
+}
+
+std::unique_ptr<HealthSource> SmartCharge::connectHealth(bool *fallback) {
+  bool linkToDeathSuccess = true;
   std::string reason;
-  ScopedLock _(hal_health_lock);
+  std::unique_ptr<HealthSource> source;
 
+  *fallback = false;
   // Try aidl
-  health_aidl = waitServiceDefault<IHealthAIDL>();
+  auto health_aidl = waitForDeclaredServiceDefault<IHealthAIDL>();
   if (health_aidl == nullptr) {
     // hidl
-    health_hidl = ::android::hardware::health::V2_0::get_health_service();
-    if (health_hidl != nullptr) {
-      healthState = USE_HEALTH_HIDL;
-      ALOGD("%s: Connected to health HIDL V2.0 HAL", __func__);
-      hidl_death_recp = new hidl_health_death_recipient(health_hidl);
-      auto ret = health_hidl->linkToDeath(hidl_death_recp,
-                                          reinterpret_cast<uint64_t>(this));
-      linkToDeathSuccess = ret.isOk();
-      reason = ret.description();
-    } else {
-      LOG_ALWAYS_FATAL("Failed to connect to any valid health HAL");
+    auto health_hidl = ::android::hardware::health::V2_0::get_health_service();
+    if (health_hidl == nullptr) {
+      // No HAL to push info or report its death, read power_supply directly
+      source = SysfsHealthSource::open();
+      if (source)
+        ALOGD("%s: No health HAL, using sysfs power_supply nodes", __func__);
+      *fallback = true;
+      return source;
     }
+    ALOGD("%s: Connected to health HIDL V2.0 HAL", __func__);
+    hidl_death_recp = new hidl_health_death_recipient(health_hidl);
+    auto ret = health_hidl->linkToDeath(hidl_death_recp,
+                                        reinterpret_cast<uint64_t>(this));
+    linkToDeathSuccess = ret.isOk();
+    reason = ret.description();
+    source = std::make_unique<HidlHealthSource>(health_hidl);
   } else {
-    healthState = USE_HEALTH_AIDL;
     ALOGD("%s: Connected to health AIDL HAL", __func__);
     aidl_death_recp = ndk::ScopedAIBinder_DeathRecipient(
         AIBinder_DeathRecipient_new(onServiceDied));
@@ -125,36 +197,248 @@ void SmartCharge::loadHealthImpl(void) {
                                     aidl_death_recp.get(), this);
     linkToDeathSuccess = ret == STATUS_OK;
     reason = ndk::ScopedAStatus(AStatus_fromStatus(ret)).getDescription();
+    source = std::make_unique<AidlHealthSource>(health_aidl);
   }
   if (!linkToDeathSuccess)
     ALOGW("%s: linkToDeath failed: %s", __func__, reason.c_str());
+  return source;
+}
+
+// Only called by whoever replaces healthSource, so it is stable meanwhile
+void SmartCharge::updateHealthBackendStatus(void) {
+  const char *name = healthSource ? healthSource->getName() : "";
+  ScopedLock _(status_lock);
+  statusSnapshot.healthBackend = name;
+}
+
+void SmartCharge::installHealthSource(std::unique_ptr<HealthSource> source,
+                                      const bool fallback) {
+  HealthSource *const raw = source.get();
+
+  {
+    // Whatever was pushed by the old backend is stale now
+    ScopedLock _(pushed_info_lock);
+    pushedInfo.valid = false;
+  }
+  {
+    ScopedLock _(hal_health_lock);
+    healthSource = std::move(source);
+    healthFallback = fallback;
+  }
+  updateHealthBackendStatus();
+  // Only this thread replaces the backend, raw stays valid. Registering may
+  // push info right away, which must not be cleared above.
+  if (!raw->registerListener(
+          [this](const HealthSample &sample) { onHealthInfoChanged(sample); }))
+    ALOGW("%s: registerCallback failed, falling back to polling", __func__);
+  // Let the loop take a fresh sample
+  wakeLoop();
+}
+
+void SmartCharge::healthConnectLoop(void) {
+  std::chrono::nanoseconds retryDelay = kConnectRetryMin;
+  std::unique_lock<std::mutex> lk(health_connect_lock);
+
+  // Exits once connected, unless asked to reconnect meanwhile
+  while (healthReconnect && !healthConnectStop) {
+    healthReconnect = false;
+    lk.unlock();
+
+    std::unique_ptr<HealthSource> old;
+    {
+      // The loop goes on with its last sample until reconnected. The sysfs
+      // fallback keeps serving it meanwhile.
+      ScopedLock _(hal_health_lock);
+      if (!healthFallback)
+        old = std::move(healthSource);
+    }
+    updateHealthBackendStatus();
+    // Destroying a HAL backend unregisters its callback, a binder call
+    old.reset();
+    bool fallback;
+    auto source = connectHealth(&fallback);
+    if (source) {
+      installHealthSource(std::move(source), fallback);
+      retryDelay = kConnectRetryMin;
+      lk.lock();
+      continue;
+    }
+
+    ALOGE("%s: No health HAL available, retrying in %llds", __func__,
+          static_cast<long long>(
+              std::chrono::duration_cast<std::chrono::seconds>(retryDelay).count()));
+    lk.lock();
+    if (health_connect_cv.wait_for(lk, retryDelay, [this] { return healthConnectStop; }))
+      break;
+    healthReconnect = true;
+    retryDelay = std::min<std::chrono::nanoseconds>(retryDelay * 2, kConnectRetryMax);
+  }
+  healthConnecting = false;
+}
+
+void SmartCharge::storeConfig(const ChargeConfig &config) {
+  std::atomic_store(&kConfig, std::shared_ptr<const ChargeConfig>(
+                                  std::make_shared<ChargeConfig>(config)));
+  {
+    ScopedLock _(status_lock);
+    statusSnapshot.upper = config.upper;
+    statusSnapshot.lower = config.lower;
+    statusSnapshot.restart = config.restart;
+  }
+  notifier.notifyConfig(config);
+}
+
+void SmartCharge::loadScheduleProp(void) {
+  const std::string propval = GetProperty(kSmartChargeScheduleProp, "");
+  std::vector<ChargeSchedule::Window> windows;
+  auto schedule = std::make_shared<ChargeSchedule>();
+
+  if (propval.empty())
+    return;
+  if (!ChargeSchedule::fromString(propval, &windows) || !schedule->setWindows(windows)) {
+    ALOGW("%s: Parsing schedule failed, ignoring it", __func__);
+    return;
+  }
+  ScopedLock _(config_lock);
+  std::atomic_store(&kSchedule, std::shared_ptr<const ChargeSchedule>(schedule));
+  ALOGD("%s: %s", __func__, propval.c_str());
+}
+
+const ChargeSchedule::Window *
+SmartCharge::evaluateSchedule(const ChargeSchedule &schedule) {
+  using std::chrono::duration_cast;
+  using std::chrono::seconds;
+  struct itimerspec spec = {};
+  const ChargeSchedule::Window *window = nullptr;
+
+  // Disarmed while there is no schedule
+  if (!schedule.empty()) {
+    const auto sinceMidnight = clock.sinceLocalMidnight();
+    const auto left = schedule.timeToNextBoundary(sinceMidnight);
+    window = schedule.lookup(sinceMidnight);
+    if (left != ChargeSchedule::Duration::max()) {
+      // Absolute, so setting the clock cancels it. Zone changes do not, they
+      // are caught up with on the next evaluation or recheck.
+      struct timespec now = {};
+      struct tm nowTm = {}, atTm = {};
+      clock_gettime(CLOCK_REALTIME, &now);
+      auto at = seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec) +
+                std::min<ChargeSchedule::Duration>(left, kScheduleRecheck);
+      // Boundary is in local time, move it by a UTC offset change, e.g. DST,
+      // before it is reached
+      const time_t atSec = duration_cast<seconds>(at).count();
+      localtime_r(&now.tv_sec, &nowTm);
+      localtime_r(&atSec, &atTm);
+      at -= seconds(atTm.tm_gmtoff - nowTm.tm_gmtoff);
+      spec.it_value.tv_sec = duration_cast<seconds>(at).count();
+      spec.it_value.tv_nsec = (at % seconds(1)).count();
+    }
+  }
+  if (timerfd_settime(kScheduleTimerFd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                      &spec, nullptr) < 0)
+    ALOGE("%s: timerfd_settime: %s", __func__, strerror(errno));
+  if (window && window != loop.window)
+    ALOGD("%s: In window %02d:%02d-%02d:%02d, upper: %d, lower: %d", __func__,
+          window->startMinute / 60, window->startMinute % 60, window->endMinute / 60,
+          window->endMinute % 60, window->upper, window->lower);
+  return window;
 }
 
 bool SmartCharge::loadAndParseConfigProp(void) {
   ConfigPair<int> ret{};
   if (getAndParse(kSmartChargeConfigProp, &ret) &&
       verifyConfig(ret.first, ret.second)) {
-    upper = ret.second;
-    lower = ret.first;
-    ALOGD("%s: upper: %d, lower: %d", __func__, upper, lower);
+    ScopedLock _(config_lock);
+    storeConfig({ret.second, ret.first, false});
+    ALOGD("%s: upper: %d, lower: %d", __func__, ret.second, ret.first);
   } else {
-    upper = kInvalidCfg;
-    lower = kInvalidCfg;
+    ScopedLock _(config_lock);
+    storeConfig({kInvalidCfg, kInvalidCfg, false});
     ALOGW("%s: Parsing config failed", __func__);
     return false;
   }
   return true;
 }
 
+std::shared_ptr<ActionPlan> SmartCharge::findActionPlan(void) {
+  const std::string codename = GetProperty("ro.product.device", "");
+  const std::string vendor = GetProperty("ro.product.manufacturer", "");
+  std::shared_ptr<ActionPlan> plan;
+
+  if (GetBoolProperty("ro.debuggable", false) &&
+      access(kNodesOverridePath, R_OK) == 0) {
+    ALOGI("%s: Using override %s", __func__, kNodesOverridePath);
+    ConfigParser parser(kNodesOverridePath);
+    plan = parser.findEntry({codename, vendor});
+    if (plan)
+      plan->setMatch(plan->getMatch() + " (" + kNodesOverridePath + ")");
+  } else {
+    plan = findCompiledEntry(codename, vendor);
+  }
+  return plan;
+}
+
+std::shared_ptr<ActionPlan> SmartCharge::probeActionPlan(void) {
+  return probeChargeControl(kProbeCachePath, GetProperty("ro.build.fingerprint", ""));
+}
+
+void SmartCharge::installActionPlan(std::shared_ptr<ActionPlan> plan) {
+  if (!plan) {
+    ALOGD("%s: Using empty action plan", __func__);
+    plan = std::make_shared<ActionPlan>();
+  }
+  ALOGI("%s: Device entry now %s", __func__, plan->getMatch().c_str());
+  {
+    ScopedLock _(status_lock);
+    statusSnapshot.deviceEntry = plan->getMatch();
+  }
+  std::atomic_store(&actionPlan, std::move(plan));
+  // Let the loop hand charge control over to the new plan
+  if (kRunning)
+    wakeLoop();
+}
+
+void SmartCharge::reloadActionPlan(void) {
+  ScopedLock _(plan_lock);
+  auto plan = findActionPlan();
+
+  if (!plan)
+    plan = probeActionPlan();
+  installActionPlan(std::move(plan));
+}
+
+void SmartCharge::probeAndInstall(const std::shared_ptr<ActionPlan> placeholder) {
+  auto plan = probeActionPlan();
+
+  if (!plan)
+    return;
+  ScopedLock _(plan_lock);
+  // Reloaded from the override meanwhile, which takes precedence
+  if (loadActionPlan() != placeholder)
+    return;
+  installActionPlan(std::move(plan));
+}
+
 void SmartCharge::loadConfiguration(void) {
-  ConfigParser parser("/system_ext/etc/smartcharge_nodes.json");
+  {
+    ScopedLock _(plan_lock);
+    auto plan = findActionPlan();
 
-  setChargableFunc = parser.findEntry({GetProperty("ro.product.device", ""),
-                                       GetProperty("ro.product.manufacturer", "")});
-  if (!setChargableFunc) {
-    ALOGD("%s: Using stub for setChargableFunc", __func__);
-    setChargableFunc = [](const bool) {};
+    if (plan) {
+      installActionPlan(std::move(plan));
+    } else {
+      // Probing waits on every candidate's driver, do it off the way of
+      // service registration and let the loop run the empty plan meanwhile
+      installActionPlan(nullptr);
+      probe_thread = std::thread(&SmartCharge::probeAndInstall, this, loadActionPlan());
+    }
   }
+  if (!GetBoolProperty("ro.debuggable", false))
+    return;
+  // Parsing happens on the watcher thread, the loop only sees the swap
+  nodesWatcher = FileWatcher::watch(kNodesOverridePath, [this] { reloadActionPlan(); });
+  if (!nodesWatcher)
+    ALOGW("%s: Not watching %s for changes", __func__, kNodesOverridePath);
 }
 
 void SmartCharge::loadEnabledAndStart(void) {
@@ -163,7 +447,7 @@ void SmartCharge::loadEnabledAndStart(void) {
   if (getAndParse(kSmartChargeEnabledProp, &ret)) {
     if (ret.first) {
       ALOGD("%s: Starting loop, withrestart: %d", __func__, ret.second);
-      createLoopThread(ret.second);
+      createLoop(ret.second);
     } else
       ALOGD("%s: Not starting loop", __func__);
   } else {
@@ -172,11 +456,91 @@ void SmartCharge::loadEnabledAndStart(void) {
   }
 }
 
-SmartCharge::SmartCharge(void) {
+void SmartCharge::loadUeventListener(void) {
+  if (!GetBoolProperty(kSmartChargeUeventProp, true)) {
+    ALOGD("%s: uevent disabled by property, polling", __func__);
+    return;
+  }
+  ueventEnabled = true;
+  openUevent();
+}
+
+void SmartCharge::openUevent(void) {
+  uevent = ueventOpener();
+  if (!uevent) {
+    ALOGW("%s: Failed to open uevent socket, polling", __func__);
+    return;
+  }
+  if (!reactor.add(uevent->getFd(), EPOLLIN,
+                   [this](uint32_t events) { onUevent(events); })) {
+    uevent.reset();
+    return;
+  }
+  ScopedLock _(status_lock);
+  ueventActive = true;
+}
+
+void SmartCharge::closeUevent(void) {
+  if (!uevent)
+    return;
+  reactor.remove(uevent->getFd());
+  uevent.reset();
+  ScopedLock _(status_lock);
+  ueventActive = false;
+}
+
+SmartCharge::~SmartCharge(void) {
+  // Their handlers and callbacks use everything else
+  reactor.stop();
+  nodesWatcher.reset();
+  {
+    ScopedLock _(health_connect_lock);
+    healthConnectStop = true;
+  }
+  health_connect_cv.notify_one();
+  // May wait for a pending servicemanager wait to return
+  if (health_connect_thread.joinable())
+    health_connect_thread.join();
+  if (probe_thread.joinable())
+    probe_thread.join();
+}
+
+SmartCharge::SmartCharge(UeventOpener openUevent)
+    : ueventOpener(std::move(openUevent)) {
   bool ret;
 
+  kWakeFd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+  if (kWakeFd < 0)
+    LOG_ALWAYS_FATAL("Failed to create eventfd: %s", strerror(errno));
+  kTimerFd.reset(timerfd_create(CLOCK_BOOTTIME, TFD_CLOEXEC | TFD_NONBLOCK));
+  if (kTimerFd < 0)
+    LOG_ALWAYS_FATAL("Failed to create timerfd: %s", strerror(errno));
+  kScheduleTimerFd.reset(timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC | TFD_NONBLOCK));
+  if (kScheduleTimerFd < 0)
+    LOG_ALWAYS_FATAL("Failed to create timerfd: %s", strerror(errno));
+
+  // Nothing sampled yet, charging is left as is until the loop decides
+  statusSnapshot.running = false;
+  statusSnapshot.chargingEnabled = true;
+  statusSnapshot.capacity = -1;
+  statusSnapshot.batteryStatus = SmartChargeStatus::BATTERY_STATUS_UNKNOWN;
+  statusSnapshot.sampleTimestampMs = -1;
+
+  // Health HAL pushes info and reports its death, so it is what the loop
+  // runs on. It is waited for in background, not to delay service
+  // registration, sysfs serves the loop until then.
+  healthSource = SysfsHealthSource::open();
+  healthFallback = true;
+  updateHealthBackendStatus();
   loadHealthImpl();
   loadConfiguration();
+  loadUeventListener();
+  loadScheduleProp();
+
+  reactor.add(kWakeFd, EPOLLIN, [this](uint32_t) { onWake(); });
+  reactor.add(kTimerFd, EPOLLIN, [this](uint32_t) { onTimer(); });
+  reactor.add(kScheduleTimerFd, EPOLLIN, [this](uint32_t) { onScheduleTimer(); });
+  reactor.start();
 
   ret = loadAndParseConfigProp();
   if (ret) {
@@ -184,131 +548,296 @@ SmartCharge::SmartCharge(void) {
   }
 }
 
-void SmartCharge::startLoop(bool withrestart) {
-  ChargeStatus current, policy;
-  bool skip = false;
+void SmartCharge::wakeLoop(void) {
+  uint64_t val = 1;
+  TEMP_FAILURE_RETRY(write(kWakeFd, &val, sizeof(val)));
+}
 
-  ALOGD("%s: ++", __func__);
-  std::unique_lock<std::mutex> lock(kCVLock);
-  while (true) {
-    int per;
+void SmartCharge::onWake(void) {
+  uint64_t val;
+  TEMP_FAILURE_RETRY(read(kWakeFd, &val, sizeof(val)));
+  // New health info, config, or a start or stop request
+  telemetry.recordWakeup(Telemetry::WakeReason::NOTIFY);
+  runLoop();
+}
 
-    switch (healthState) {
-    case USE_HEALTH_AIDL: {
-      using android::hardware::health::BatteryStatus;
+void SmartCharge::onTimer(void) {
+  uint64_t expirations;
+  TEMP_FAILURE_RETRY(read(kTimerFd, &expirations, sizeof(expirations)));
+  telemetry.recordWakeup(Telemetry::WakeReason::TIMER);
+  runLoop();
+}
 
-      ScopedLock _(hal_health_lock);
-      BatteryStatus status_aidl = BatteryStatus::UNKNOWN;
-      auto ret = health_aidl->getCapacity(&per);
-      if (!ret.isOk()) {
-        per = ret.getStatus();
-        break;
-      }
-      ret = health_aidl->getChargeStatus(&status_aidl);
-      if (!ret.isOk()) {
-        per = ret.getStatus();
-        break;
-      }
-      switch (status_aidl) {
-      case BatteryStatus::CHARGING:
-      case BatteryStatus::FULL:
-        current = ChargeStatus::ON;
-        break;
-      case BatteryStatus::DISCHARGING:
-      case BatteryStatus::NOT_CHARGING:
-        current = ChargeStatus::OFF;
-        break;
-      default:
-        break;
-      };
-      break;
+void SmartCharge::onScheduleTimer(void) {
+  uint64_t expirations;
+  // Fails with ECANCELED if wall clock was set, the window is looked up
+  // again either way
+  TEMP_FAILURE_RETRY(read(kScheduleTimerFd, &expirations, sizeof(expirations)));
+  telemetry.recordWakeup(Telemetry::WakeReason::SCHEDULE);
+  runLoop();
+}
+
+void SmartCharge::onUevent(const uint32_t events) {
+  if (events & (EPOLLERR | EPOLLHUP)) {
+    ALOGE("%s: uevent socket broken, falling back to polling", __func__);
+    closeUevent();
+    return;
+  }
+  // Only re-evaluate policy if capacity or status actually changed
+  if (uevent->handleEvents()) {
+    telemetry.recordWakeup(Telemetry::WakeReason::UEVENT);
+    runLoop();
+  }
+}
+
+void SmartCharge::armTimer(const std::chrono::nanoseconds timeout) {
+  using std::chrono::duration_cast;
+  using std::chrono::seconds;
+
+  // Zero disarms
+  struct itimerspec spec = {};
+  spec.it_value.tv_sec = duration_cast<seconds>(timeout).count();
+  spec.it_value.tv_nsec = (timeout % seconds(1)).count();
+  if (timerfd_settime(kTimerFd, 0, &spec, nullptr) < 0)
+    ALOGE("%s: timerfd_settime: %s", __func__, strerror(errno));
+}
+
+void SmartCharge::runLoop(void) {
+  const bool running = kRunning;
+
+  if (running && !loop.active) {
+    enterLoop();
+  } else if (!running && loop.active) {
+    leaveLoop();
+    // Let the device charge again
+    loadActionPlan()->apply(true);
+    telemetry.recordActuation(clock.now(), ChargeStatus::ON);
+    {
+      ScopedLock _(status_lock);
+      statusSnapshot.chargingEnabled = true;
     }
-    case USE_HEALTH_HIDL: {
-      using ::android::hardware::health::V1_0::BatteryStatus;
-      using ::android::hardware::health::V2_0::Result;
+    notifier.notifyChargeControl(true, -1);
+  }
+  if (loop.active)
+    evaluate();
+}
 
-      ScopedLock _(hal_health_lock);
-      Result res = Result::UNKNOWN;
-      BatteryStatus status_hidl = BatteryStatus::UNKNOWN;
-      health_hidl->getCapacity([&res, &per](Result hal_res, int32_t hal_value) {
-        res = hal_res;
-        per = hal_value;
-      });
-      if (res != Result::SUCCESS) {
-        per = -(static_cast<int>(res));
-        break;
-      }
-      health_hidl->getChargeStatus(
-          [&res, &status_hidl](Result hal_res, BatteryStatus hal_value) {
-            res = hal_res;
-            status_hidl = hal_value;
-          });
-      if (res != Result::SUCCESS) {
-        per = -(static_cast<int>(res));
-        break;
-      }
-      switch (status_hidl) {
-      case BatteryStatus::CHARGING:
-      case BatteryStatus::FULL:
-        current = ChargeStatus::ON;
-        break;
-      case BatteryStatus::DISCHARGING:
-      case BatteryStatus::NOT_CHARGING:
-        current = ChargeStatus::OFF;
-        break;
-      default:
-        break;
-      };
-      break;
+void SmartCharge::enterLoop(void) {
+  ALOGD("%s", __func__);
+  controller.reset();
+  actuations.cancel();
+  loop = {};
+  loop.active = true;
+  loop.plan = loadActionPlan();
+  scheduleChanged = true;
+}
+
+void SmartCharge::leaveLoop(void) {
+  ALOGD("%s", __func__);
+  stopOffload();
+  struct itimerspec off = {};
+  timerfd_settime(kTimerFd, 0, &off, nullptr);
+  timerfd_settime(kScheduleTimerFd, 0, &off, nullptr);
+  // Reloaded meanwhile, the new plan did not take over from this one
+  if (loop.plan != loadActionPlan())
+    loop.plan->apply(true);
+  actuations.cancel();
+  loop = {};
+}
+
+bool SmartCharge::updateOffload(const ChargeConfig &config) {
+  // Firmware only holds charge at its cap, discharging down to lower before
+  // charging again is left to the software loop
+  if (config.restart || !loop.plan->canOffload(config.upper) ||
+      !loop.plan->offload(config.upper)) {
+    stopOffload();
+    return false;
+  }
+  if (offloaded)
+    return true;
+  ALOGI("%s: Firmware holds charge at %d%%, pausing loop", __func__, config.upper);
+  offloaded = true;
+  actuations.cancel();
+  // Nothing must keep charging disabled underneath the cap
+  loop.plan->apply(true);
+  if (status != ChargeStatus::ON) {
+    telemetry.recordActuation(clock.now(), ChargeStatus::ON);
+    {
+      ScopedLock _(status_lock);
+      status = ChargeStatus::ON;
+      statusSnapshot.chargingEnabled = true;
     }
-    default:
-      __builtin_unreachable();
+    notifier.notifyChargeControl(true, -1);
+  }
+  armTimer(std::chrono::nanoseconds::zero());
+  closeUevent();
+  return true;
+}
+
+void SmartCharge::stopOffload(void) {
+  if (!offloaded)
+    return;
+  ALOGI("%s: Resuming loop", __func__);
+  loop.plan->releaseOffload();
+  offloaded = false;
+  // Whatever it learnt predates the pause
+  controller.reset();
+  if (ueventEnabled)
+    openUevent();
+}
+
+void SmartCharge::evaluate(void) {
+  const auto cpuStart = threadCpuTime();
+  HealthSample sample = {};
+  int per = 0;
+  bool pushed, connected = true;
+
+  // Zone and DST changes move the window without any event, so it is
+  // looked up on every evaluation, a clock read and an O(1) lookup
+  if (scheduleChanged.exchange(false)) {
+    loop.schedule = loadSchedule();
+    loop.window = nullptr;
+  }
+  loop.window = evaluateSchedule(*loop.schedule);
+  // Pick up whatever configuration is current, without blocking writers
+  const auto config = ChargeSchedule::apply(*loadConfig(), loop.window);
+  if (auto current = loadActionPlan(); current != loop.plan) {
+    // Old nodes must not keep charging disabled or capped behind the new
+    // ones' back, the new plan programs its cap again if it has one
+    if (offloaded)
+      loop.plan->releaseOffload();
+    if (!loop.plan->hasSameActions(*current))
+      loop.plan->apply(true);
+    // Last reference to the old plan, its fds are closed here
+    loop.plan = std::move(current);
+  }
+  if (updateOffload(config))
+    return;
+
+  {
+    ScopedLock _(pushed_info_lock);
+    pushed = pushedInfo.valid;
+    sample = pushedInfo.sample;
+  }
+  // Ask the backend only if nothing was pushed yet
+  if (!pushed) {
+    ScopedLock _(hal_health_lock);
+    if (healthSource)
+      per = healthSource->read(&sample);
+    else
+      connected = false;
+  }
+  if (per < 0 && loop.haveSample) {
+    // Most likely the HAL died, do not give up before it is back
+    ALOGW("%s: Reading health failed: %d, reconnecting", __func__, per);
+    loadHealthImpl();
+    connected = false;
+  }
+  if (!connected) {
+    // Go on with the last sample, reconnection wakes us up
+    if (!loop.haveSample) {
+      armTimer(kHealthConnectWait);
+      return;
     }
-    if (per < 0) {
-      SetProperty(kSmartChargeEnabledProp, kDisabledCfgStr);
-      ALOGE("%s: exit loop: retval: %d", __func__, per);
-      break;
+    sample = loop.lastSample;
+    per = 0;
+  }
+  if (per == 0)
+    per = sample.capacity;
+  if (per < 0) {
+    SetProperty(kSmartChargeEnabledProp, kDisabledCfgStr);
+    ALOGE("%s: exit loop: retval: %d", __func__, per);
+    kRunning = false;
+    leaveLoop();
+    {
+      ScopedLock _(status_lock);
+      statusSnapshot.running = false;
     }
-    if (per > upper)
-      policy = ChargeStatus::OFF;
-    else if (withrestart && per < lower)
-      policy = ChargeStatus::ON;
-    else if (!withrestart && per < upper)
-      policy = ChargeStatus::ON;
+    notifier.notifyLoopState(false, ISmartChargeCallback::REASON_HEALTH_ERROR);
+    return;
+  }
+  loop.lastSample = sample;
+  loop.haveSample = true;
+  notifier.notifyCapacity(per);
+  const auto now = clock.now();
+  telemetry.recordSample(now, sample);
+  // A stale sample of a disconnected backend confirms nothing
+  if (connected)
+    actuations.onSample(now, sample);
+  {
+    ScopedLock _(status_lock);
+    statusSnapshot.capacity = per;
+    if (!sample.statusKnown)
+      statusSnapshot.batteryStatus = SmartChargeStatus::BATTERY_STATUS_UNKNOWN;
+    else if (sample.status == ChargeStatus::ON)
+      statusSnapshot.batteryStatus = SmartChargeStatus::BATTERY_STATUS_CHARGING;
     else
-      skip = true;
-
-    if (current != policy && !skip) {
-      ALOGD("%s: Updating current, current %d, policy %d", __func__, current,
-            policy);
-      switch (policy) {
-      case ChargeStatus::OFF:
-        setChargableFunc(false);
-        break;
-      case ChargeStatus::ON:
-        setChargableFunc(true);
-        break;
-      default:
-        break;
-      }
-      status = policy;
-    }
-    skip = false;
-    if (cv.wait_for(lock, 5s) == std::cv_status::no_timeout) {
-      // cv signaled, exit now if kRunning is false
-      if (!kRunning)
-        break;
+      statusSnapshot.batteryStatus = SmartChargeStatus::BATTERY_STATUS_DISCHARGING;
+    statusSnapshot.sampleTimestampMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+  }
+  const auto step = controller.step(sample, config, uevent || pushed);
+  if (step.statusChanged)
+    loop.plan->invalidate();
+  if (step.actuate) {
+    ALOGD("%s: Updating current, policy %d", __func__, step.policy);
+    telemetry.recordDecision(now, per, step.policy);
+    actuate(step.policy);
+    {
+      ScopedLock _(status_lock);
+      status = step.policy;
+      statusSnapshot.chargingEnabled = step.policy == ChargeStatus::ON;
     }
+    notifier.notifyChargeControl(step.policy == ChargeStatus::ON, per);
   }
-  ALOGD("%s: --", __func__);
+  // Asking again above writes nothing, the node already holds the state
+  if (ChargeStatus state; actuations.shouldRetry(now, &state)) {
+    // Charger did not follow, the node may have been reset underneath
+    ALOGW("%s: Charge %s not confirmed, writing again", __func__,
+          state == ChargeStatus::ON ? "enable" : "disable");
+    loop.plan->invalidate();
+    loop.plan->apply(state == ChargeStatus::ON);
+    telemetry.recordActuation(clock.now(), state);
+  }
+  telemetry.recordIterationCpu(threadCpuTime() - cpuStart);
+  // Wake up for the retry if no sample confirms it before
+  armTimer(std::clamp<std::chrono::nanoseconds>(actuations.timeToRetry(clock.now()),
+                                                1ms, step.wakeInterval));
+}
+
+void SmartCharge::actuate(const ChargeStatus state) {
+  const bool enable = state == ChargeStatus::ON;
+  const auto now = clock.now();
+
+  loop.plan->apply(enable);
+  telemetry.recordActuation(now, state);
+  // Nothing to confirm or retry without a charger, e.g. the policy asks to
+  // charge below lower while unplugged
+  if (loop.lastSample.chargerKnown && !loop.lastSample.chargerOnline)
+    actuations.cancel();
+  else
+    actuations.onActuation(now, state, loop.plan->getNode(enable));
 }
 
-void SmartCharge::createLoopThread(bool restart) {
-  ScopedLock _(thread_lock);
-  ALOGD("%s: create thread", __func__);
-  kLoopThread =
-      std::make_shared<std::thread>(&SmartCharge::startLoop, this, restart);
+void SmartCharge::createLoop(bool restart) {
+  {
+    ScopedLock _(config_lock);
+    auto config = *loadConfig();
+    config.restart = restart;
+    storeConfig(config);
+  }
+  requestLoopStart();
+}
+
+void SmartCharge::requestLoopStart(void) {
+  ALOGD("%s", __func__);
   kRunning = true;
+  {
+    ScopedLock _(status_lock);
+    statusSnapshot.running = true;
+  }
+  notifier.notifyLoopState(true, ISmartChargeCallback::REASON_REQUESTED);
+  wakeLoop();
 }
 
 ndk::ScopedAStatus SmartCharge::setChargeLimit(int32_t upper_, int32_t lower_) {
@@ -316,17 +845,23 @@ ndk::ScopedAStatus SmartCharge::setChargeLimit(int32_t upper_, int32_t lower_) {
         kRunning.load());
   if (!verifyConfig(lower_, upper_))
     return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
-  if (kRunning)
-    return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
   if (lower_ < 0)
     lower_ = kInvalidCfg;
-  auto pair = ConfigPair<int>{lower_, upper_};
-  SetProperty(kSmartChargeConfigProp, pair.toString());
   {
-    std::unique_lock<std::mutex> _(config_lock);
-    lower = lower_;
-    upper = upper_;
+    ScopedLock _(config_lock);
+    auto config = *loadConfig();
+    // Running loop with restart cannot go on without a lower limit
+    if (kRunning && config.restart && lower_ == kInvalidCfg)
+      return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
+    auto pair = ConfigPair<int>{lower_, upper_};
+    SetProperty(kSmartChargeConfigProp, pair.toString());
+    config.lower = lower_;
+    config.upper = upper_;
+    storeConfig(config);
   }
+  // Let the loop evaluate new limits right away
+  if (kRunning)
+    wakeLoop();
   ALOGD("%s: Exit", __func__);
   return ndk::ScopedAStatus::ok();
 }
@@ -334,12 +869,13 @@ ndk::ScopedAStatus SmartCharge::setChargeLimit(int32_t upper_, int32_t lower_) {
 ndk::ScopedAStatus SmartCharge::activate(bool enable, bool restart) {
   auto pair = ConfigPair<bool>{enable, restart};
   {
-    std::unique_lock<std::mutex> _(config_lock);
+    const auto config = loadConfig();
     ALOGD("%s: upper: %d, lower: %d, enable: %d, restart: %d, kRun: %d",
-          __func__, upper, lower, enable, restart, kRunning.load());
-    if (!verifyConfig(lower, upper))
+          __func__, config->upper, config->lower, enable, restart,
+          kRunning.load());
+    if (!verifyConfig(config->lower, config->upper))
       return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
-    if (lower == kInvalidCfg && restart)
+    if (config->lower == kInvalidCfg && restart)
       return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
   }
   if (kRunning == enable)
@@ -349,39 +885,179 @@ ndk::ScopedAStatus SmartCharge::activate(bool enable, bool restart) {
     if (kRunning) {
       ALOGW("Thread is running?");
     } else {
-      createLoopThread(restart);
+      createLoop(restart);
     }
   } else {
-    setChargableFunc(true);
-    if (kRunning) {
-      ScopedLock _(thread_lock);
-      kRunning = false;
-      if (kLoopThread->joinable()) {
-        cv.notify_one();
-        kLoopThread->join();
-      }
-      kLoopThread.reset();
-    } else {
-      ALOGW("No threads to stop?");
-    }
+    requestLoopStop();
   }
   ALOGD("%s: Exit", __func__);
   return ndk::ScopedAStatus::ok();
 }
 
-binder_status_t SmartCharge::dump(int fd, const char ** /* args */,
-                                  uint32_t /* numArgs */) {
-  Dl_info info;
-  void *addr;
+void SmartCharge::requestLoopStop(void) {
+  ALOGD("%s", __func__);
+  // The reactor lets the device charge again right away, nothing to wait for
+  kRunning = false;
+  {
+    ScopedLock _(status_lock);
+    statusSnapshot.running = false;
+  }
+  notifier.notifyLoopState(false, ISmartChargeCallback::REASON_REQUESTED);
+  wakeLoop();
+}
+
+ndk::ScopedAStatus SmartCharge::setConfig(const SmartChargeConfig &in) {
+  const int lower = in.lower < 0 ? kInvalidCfg : in.lower;
+
+  ALOGD("%s: upper: %d, lower: %d, restart: %d, enabled: %d, kRun: %d",
+        __func__, in.upper, lower, in.restart, in.enabled, kRunning.load());
+  // Check everything before touching anything
+  if (!verifyConfig(lower, in.upper) || (in.restart && lower == kInvalidCfg))
+    return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+  {
+    ScopedLock _(config_lock);
+    const auto old = loadConfig();
+    // Persist only what changed, a plain toggle is a single write
+    if (old->upper != in.upper || old->lower != lower)
+      SetProperty(kSmartChargeConfigProp, ConfigPair<int>{lower, in.upper}.toString());
+    if (kRunning != in.enabled || old->restart != in.restart)
+      SetProperty(kSmartChargeEnabledProp,
+                  ConfigPair<bool>{in.enabled, in.restart}.toString());
+    storeConfig({in.upper, lower, in.restart});
+  }
+  if (in.enabled && !kRunning) {
+    requestLoopStart();
+  } else if (!in.enabled && kRunning) {
+    requestLoopStop();
+  } else if (kRunning) {
+    // Let the loop evaluate new config right away
+    wakeLoop();
+  }
+  ALOGD("%s: Exit", __func__);
+  return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus SmartCharge::setSchedule(const std::vector<ChargeWindow> &in) {
+  std::vector<ChargeSchedule::Window> windows;
+  auto schedule = std::make_shared<ChargeSchedule>();
+
+  for (const auto &w : in)
+    windows.push_back({w.startMinute, w.endMinute, w.upper, w.lower < 0 ? -1 : w.lower});
+  if (!schedule->setWindows(windows))
+    return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+  {
+    ScopedLock _(config_lock);
+    const auto str = schedule->toString();
+    ALOGD("%s: %s", __func__, str.c_str());
+    SetProperty(kSmartChargeScheduleProp, str);
+    std::atomic_store(&kSchedule, std::shared_ptr<const ChargeSchedule>(schedule));
+  }
+  scheduleChanged = true;
+  if (kRunning)
+    wakeLoop();
+  return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus SmartCharge::getSchedule(std::vector<ChargeWindow> *_aidl_return) {
+  const auto schedule = loadSchedule();
+
+  _aidl_return->clear();
+  for (const auto &w : schedule->getWindows()) {
+    ChargeWindow window;
+    window.startMinute = w.startMinute;
+    window.endMinute = w.endMinute;
+    window.upper = w.upper;
+    window.lower = w.lower;
+    _aidl_return->push_back(window);
+  }
+  return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus SmartCharge::registerCallback(
+    const std::shared_ptr<ISmartChargeCallback> &callback) {
+  if (callback == nullptr)
+    return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+  if (!notifier.registerCallback(callback))
+    ALOGD("%s: Callback registered already", __func__);
+  return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus SmartCharge::unregisterCallback(
+    const std::shared_ptr<ISmartChargeCallback> &callback) {
+  if (callback == nullptr || !notifier.unregisterCallback(callback))
+    return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+  return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus SmartCharge::getStatus(SmartChargeStatus *_aidl_return) {
+  ScopedLock _(status_lock);
+  *_aidl_return = statusSnapshot;
+  return ndk::ScopedAStatus::ok();
+}
+
+binder_status_t SmartCharge::dump(int fd, const char **args,
+                                  uint32_t numArgs) {
+  bool stats = false, records = false, json = false;
+  const auto now = clock.now();
+
+  for (uint32_t i = 0; i < numArgs; ++i) {
+    if (strcmp(args[i], "--stats") == 0) {
+      stats = true;
+    } else if (strcmp(args[i], "--samples") == 0) {
+      records = true;
+    } else if (strcmp(args[i], "--json") == 0) {
+      json = true;
+    } else {
+      dprintf(fd, "Usage: dumpsys %s/default [--stats] [--samples] [--json]\n",
+              SmartCharge::descriptor);
+      return STATUS_BAD_VALUE;
+    }
+  }
+  if (json) {
+    // Everything unless asked otherwise, as one object
+    if (!stats && !records)
+      stats = records = true;
+    dprintf(fd, "{\"running\":%s", kRunning ? "true" : "false");
+    if (stats) {
+      dprintf(fd, ",\"stats\":");
+      telemetry.dumpStats(fd, now, true);
+      dprintf(fd, ",\"actuations\":");
+      actuations.dump(fd, true);
+    }
+    if (records) {
+      dprintf(fd, ",\"samples\":");
+      telemetry.dumpRecords(fd, true);
+    }
+    dprintf(fd, "}\n");
+    return STATUS_OK;
+  }
+  if (stats || records) {
+    if (stats) {
+      telemetry.dumpStats(fd, now, false);
+      actuations.dump(fd, false);
+    }
+    if (records)
+      telemetry.dumpRecords(fd, false);
+    return STATUS_OK;
+  }
+
   auto tryLockFn = [](std::mutex &m) {
     const std::unique_lock<std::mutex> lk{m, std::try_to_lock};
     return !lk.owns_lock();
   };
 
-  dprintf(fd, "Loop thread running: %d\n", kRunning.load());
+  // Reactor owned state, as of its last update
+  ChargeStatus loopStatus;
+  bool ueventOpen;
+  {
+    ScopedLock _(status_lock);
+    loopStatus = status;
+    ueventOpen = ueventActive;
+  }
+  dprintf(fd, "Loop running: %d\n", kRunning.load());
   if (kRunning) {
-    dprintf(fd, "Loop thread charge control state: ");
-    switch (status) {
+    dprintf(fd, "Loop charge control state: ");
+    switch (loopStatus) {
     case ChargeStatus::ON:
       dprintf(fd, "ON");
       break;
@@ -391,20 +1067,50 @@ binder_status_t SmartCharge::dump(int fd, const char ** /* args */,
     }
     dprintf(fd, "\n");
   }
-  dprintf(fd, "Configuration (upper/lower): %d %d\n", upper, lower);
-  dprintf(fd, "Mutex locked (config/thread/cv) %d %d %d\n",
-          tryLockFn(config_lock), tryLockFn(thread_lock), tryLockFn(kCVLock));
-  dprintf(fd, "Connected Health HAL: ");
-  switch (healthState) {
-  case USE_HEALTH_AIDL:
-    dprintf(fd, "AIDL Health HAL V1");
-    break;
-  case USE_HEALTH_HIDL:
-    dprintf(fd, "HIDL Health HAL V2.0");
-    break;
-  default:
-    break;
-  };
+  {
+    const auto config = loadConfig();
+    dprintf(fd, "Configuration (upper/lower/restart): %d %d %d\n",
+            config->upper, config->lower, config->restart);
+    const auto schedule = loadSchedule();
+    const auto *window = schedule->lookup(clock.sinceLocalMidnight());
+    dprintf(fd, "Schedule: %s\n",
+            schedule->empty() ? "none" : schedule->toString().c_str());
+    if (window) {
+      const auto effective = ChargeSchedule::apply(*config, window);
+      dprintf(fd, "Scheduled limits (upper/lower): %d %d\n", effective.upper,
+              effective.lower);
+    }
+  }
+  dprintf(fd, "Mutex locked (config): %d\n", tryLockFn(config_lock));
+  if (offloaded)
+    dprintf(fd, "Wakeup source: none, firmware holds charge at %d%%\n",
+            loadActionPlan()->getOffloaded());
+  else
+    dprintf(fd, "Wakeup source: %s\n", ueventOpen ? "uevent" : "polling");
+  dprintf(fd, "Registered callbacks: %zu\n", notifier.getClientCount());
+  {
+    // Both take the controller's own lock
+    double rate;
+    if (controller.getRate(&rate))
+      dprintf(fd, "Estimated charge rate: %.2f %%/h\n", rate);
+    else
+      dprintf(fd, "Estimated charge rate: unknown\n");
+    const auto timeToLimit = controller.getTimeToLimit();
+    if (timeToLimit.count() >= 0)
+      dprintf(fd, "Estimated time to limit: %llds\n",
+              static_cast<long long>(
+                  std::chrono::duration_cast<std::chrono::seconds>(timeToLimit).count()));
+    else
+      dprintf(fd, "Estimated time to limit: unknown\n");
+  }
+  {
+    ScopedLock _(pushed_info_lock);
+    dprintf(fd, "Health info pushed by HAL: %d\n", pushedInfo.valid);
+  }
+  {
+    ScopedLock _(hal_health_lock);
+    dprintf(fd, "Health source: %s", healthSource ? healthSource->getName() : "connecting");
+  }
   dprintf(fd, "\n");
   return STATUS_OK;
 }
@@ -9,6 +9,18 @@
 #include <aidl/vendor/samsung_ext/framework/battery/BnSmartCharge.h>
 #include <aidl/android/hardware/health/BnHealth.h>
 #include <healthhalutils/HealthHalUtils.h>
+#include <android-base/unique_fd.h>
+
+#include "ActionPlan.h"
+#include "ActuationTracker.h"
+#include "CallbackNotifier.h"
+#include "ChargeController.h"
+#include "ChargeSchedule.h"
+#include "FileWatcher.h"
+#include "HealthBackends.h"
+#include "Reactor.h"
+#include "Telemetry.h"
+#include "UeventListener.h"
 
 #include <dlfcn.h>
 
@@ -42,56 +54,206 @@ class hidl_health_death_recipient : public hidl_death_recipient {
 };
 
 class SmartCharge : public BnSmartCharge {
-  std::shared_ptr<std::thread> kLoopThread;
-  // Protect above thread pointer
-  std::mutex thread_lock;
+  // Runs the loop and callback delivery. Besides it, only the override
+  // FileWatcher (debuggable builds) and the health HAL connection thread
+  // (while connecting) block on their own.
+  Reactor reactor;
 
-  int upper, lower;
-  // Protect above variables
+  // Current configuration snapshot, swapped atomically as a whole
+  std::shared_ptr<const ChargeConfig> kConfig =
+      std::make_shared<const ChargeConfig>(ChargeConfig{-1, -1, false});
+  // Serialize writers of above snapshot, the loop does not take it
   std::mutex config_lock;
+  std::shared_ptr<const ChargeConfig> loadConfig(void) const {
+    return std::atomic_load(&kConfig);
+  }
+  // Publish a new snapshot, config_lock must be held
+  void storeConfig(const ChargeConfig &config);
+
+  // Daily schedule snapshot, swapped like above config, under config_lock
+  std::shared_ptr<const ChargeSchedule> kSchedule =
+      std::make_shared<const ChargeSchedule>();
+  std::shared_ptr<const ChargeSchedule> loadSchedule(void) const {
+    return std::atomic_load(&kSchedule);
+  }
+  void loadScheduleProp(void);
+  // Set when the schedule was replaced, the loop picks it up on the next
+  // evaluation
+  std::atomic_bool scheduleChanged{true};
+  // Look up the active window and arm kScheduleTimerFd for when it changes,
+  // at most kScheduleRecheck ahead. Logs if it differs from loop.window.
+  const ChargeSchedule::Window *evaluateSchedule(const ChargeSchedule &schedule);
+
+  // Start the loop with current config and given restart method
+  void createLoop(bool restart);
+  // Binder side of starting and stopping, the reactor catches up on wakeup
+  void requestLoopStart(void);
+  void requestLoopStop(void);
+  // Let the reactor re-evaluate, e.g. on new config or health info
+  void wakeLoop(void);
+
+  // Whether the loop should run. Only the reactor starts or stops it.
+  std::atomic_bool kRunning{false};
+
+  // Loop state, only touched on the reactor
+  struct {
+    bool active;
+    HealthSample lastSample;
+    bool haveSample;
+    std::shared_ptr<const ChargeSchedule> schedule;
+    const ChargeSchedule::Window *window;
+    // Plan this loop acts through, the old one until handed over
+    std::shared_ptr<ActionPlan> plan;
+  } loop = {};
+  // Reactor handlers
+  void onWake(void);
+  void onTimer(void);
+  void onScheduleTimer(void);
+  void onUevent(const uint32_t events);
+  // Catch up with kRunning, then evaluate if running
+  void runLoop(void);
+  void enterLoop(void);
+  // Disarm timers and release the plan, charging is left as is
+  void leaveLoop(void);
+  // One policy evaluation, arms kTimerFd for the next one
+  void evaluate(void);
+  void armTimer(const std::chrono::nanoseconds timeout);
 
-  // Worker function
-  void startLoop(bool withrestart);
-  // Starter function
-  void createLoopThread(bool restart);
+  // Set while firmware holds the limit: no timer, no uevents and no health
+  // pushes wake the reactor, only config, schedule and stop requests do
+  std::atomic_bool offloaded{false};
+  // Hand the limit over to firmware if the plan can express it, returns
+  // true if firmware holds it
+  bool updateOffload(const ChargeConfig &config);
+  // Lift the firmware cap and resume the software loop
+  void stopOffload(void);
 
-  // Thread status indicator
-  std::atomic_bool kRunning;
+  // eventfd used to wake up the loop, e.g. to stop it
+  ::android::base::unique_fd kWakeFd;
+  // CLOCK_BOOTTIME timerfd for the next scheduled wakeup
+  ::android::base::unique_fd kTimerFd;
+  // CLOCK_REALTIME timerfd for the next charge schedule boundary, also
+  // fires if wall clock is set
+  ::android::base::unique_fd kScheduleTimerFd;
+  // Battery uevent source, null if polling or offloaded
+  std::unique_ptr<UeventListener> uevent;
+  // Whether above is open, for dump(). Written by the reactor under
+  // status_lock.
+  bool ueventActive = false;
+  // Not disabled by property, reopened after offloading
+  bool ueventEnabled = false;
+  // Where uevents come from, the kernel unless injected
+  const std::function<std::unique_ptr<UeventListener>(void)> ueventOpener;
+  // Open the uevent socket and watch it on the reactor
+  void openUevent(void);
+  // Stop watching it and close it, the loop polls then
+  void closeUevent(void);
 
-  std::condition_variable cv;
-  // Used by above condition_variable
-  std::mutex kCVLock;
+  BootClock clock;
+  // Charge policy and wakeup scheduling of the loop
+  ChargeController controller{clock};
 
   void* handle;
-  std::function<void(const bool)> setChargableFunc;
+  // Compiled charge enable/disable actions of this device, swapped as a
+  // whole on reload. Whoever holds a reference may keep using it, so its
+  // fds are closed only once the last user let go of it.
+  std::shared_ptr<ActionPlan> actionPlan;
+  std::shared_ptr<ActionPlan> loadActionPlan(void) const {
+    return std::atomic_load(&actionPlan);
+  }
+  // Device entry from the override if there is one, else the compiled
+  // ones. Null if the device has none.
+  std::shared_ptr<ActionPlan> findActionPlan(void);
+  // Probe well known nodes, slow on the first boot of a build
+  std::shared_ptr<ActionPlan> probeActionPlan(void);
+  // Swap in plan, the empty one if null, for the loop to take over
+  void installActionPlan(std::shared_ptr<ActionPlan> plan);
+  // Look up the device entry again, from the override if there is one
+  void reloadActionPlan(void);
+  // Serialize above lookups with installing their outcome
+  std::mutex plan_lock;
+  // Probes in background when there is no device entry, and installs the
+  // outcome unless placeholder was replaced meanwhile
+  std::thread probe_thread;
+  void probeAndInstall(const std::shared_ptr<ActionPlan> placeholder);
+  // Reloads on changes of the override, on debuggable builds only
+  std::unique_ptr<FileWatcher> nodesWatcher;
 
-  sp<IHealth> health_hidl;
   sp<hidl_death_recipient> hidl_death_recp;
-  std::shared_ptr<IHealthAIDL> health_aidl;
   ndk::ScopedAIBinder_DeathRecipient aidl_death_recp;
-  // Protect health_hal pointers
+  // Backend the loop takes samples from, null while connecting
+  std::unique_ptr<HealthSource> healthSource;
+  // Above is sysfs standing in for health HAL: until it is connected, or
+  // for good if none is declared
+  bool healthFallback = false;
+  // Protect above backend pointer and flag
   std::mutex hal_health_lock;
 
-  enum {
-      UNKNOWN,
-      USE_HEALTH_AIDL,
-      USE_HEALTH_HIDL,
-  } healthState = UNKNOWN;
+  // Connects to health HAL off the reactor and binder threads, with
+  // backoff. Only exists while connecting.
+  std::thread health_connect_thread;
+  std::condition_variable health_connect_cv;
+  // Protect below flags
+  std::mutex health_connect_lock;
+  bool healthConnecting = false;
+  bool healthReconnect = false;
+  bool healthConnectStop = false;
+  void healthConnectLoop(void);
+  // Blocks until health HAL is registered. Without one, falls back to
+  // sysfs and sets fallback. Null if neither is available.
+  std::unique_ptr<HealthSource> connectHealth(bool *fallback);
+  void installHealthSource(std::unique_ptr<HealthSource> source, const bool fallback);
+
+  // Last policy applied by the loop. Written by the reactor under
+  // status_lock, so dump() can read it.
+  ChargeStatus status = ChargeStatus::ON;
+
+  // Recent samples, decisions and loop statistics for dump()
+  Telemetry telemetry;
+  // Confirms actuations against health status, times how long they take
+  ActuationTracker actuations;
+  // Write the node for state and start waiting for its confirmation
+  void actuate(const ChargeStatus state);
+
+  // Registered ISmartChargeCallbacks
+  CallbackNotifier notifier{reactor};
+
+  // Served by getStatus(), updated by whoever changes the state
+  SmartChargeStatus statusSnapshot;
+  // Protect above snapshot, no other lock is taken while holding it
+  std::mutex status_lock;
+  void updateHealthBackendStatus(void);
 
-  enum ChargeStatus {
-      ON,
-      OFF,
-  } status;
+  // Latest sample pushed by health HAL callback
+  struct {
+      bool valid;
+      HealthSample sample;
+  } pushedInfo = {};
+  // Protect above struct
+  std::mutex pushed_info_lock;
+  void onHealthInfoChanged(const HealthSample &sample);
 
   bool loadAndParseConfigProp();
   void loadConfiguration();
   void loadEnabledAndStart();
+  void loadUeventListener();
 
 public:
+  // Request (re)connection to health HAL, returns right away
   void loadHealthImpl();
-  SmartCharge();
+  using UeventOpener = std::function<std::unique_ptr<UeventListener>(void)>;
+  explicit SmartCharge(UeventOpener openUevent = UeventListener::openNetlink);
+  ~SmartCharge();
   ndk::ScopedAStatus setChargeLimit(int32_t upper, int32_t lower) override;
   ndk::ScopedAStatus activate(bool enable, bool restart) override;
+  ndk::ScopedAStatus registerCallback(
+      const std::shared_ptr<ISmartChargeCallback> &callback) override;
+  ndk::ScopedAStatus unregisterCallback(
+      const std::shared_ptr<ISmartChargeCallback> &callback) override;
+  ndk::ScopedAStatus getStatus(SmartChargeStatus *_aidl_return) override;
+  ndk::ScopedAStatus setConfig(const SmartChargeConfig &config) override;
+  ndk::ScopedAStatus setSchedule(const std::vector<ChargeWindow> &windows) override;
+  ndk::ScopedAStatus getSchedule(std::vector<ChargeWindow> *_aidl_return) override;
 
   binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
 };
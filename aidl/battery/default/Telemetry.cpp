@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "Telemetry.h"
+
+#include <cstdio>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+static const char *eventToString(const Telemetry::Event event) {
+  switch (event) {
+  case Telemetry::Event::SAMPLE:
+    return "sample";
+  case Telemetry::Event::DECISION:
+    return "decision";
+  case Telemetry::Event::ACTUATION:
+    return "actuation";
+  }
+  return "unknown";
+}
+
+static const char *statusToString(const bool known, const ChargeStatus status) {
+  if (!known)
+    return "unknown";
+  return status == ChargeStatus::ON ? "on" : "off";
+}
+
+static inline int64_t toMillis(const int64_t ns) { return ns / 1000000; }
+
+void Telemetry::push(const Record &record) {
+  const uint32_t data = static_cast<uint32_t>(record.event) |
+                        (static_cast<uint32_t>(record.capacity & 0xff) << 8) |
+                        (static_cast<uint32_t>(record.statusKnown) << 16) |
+                        (static_cast<uint32_t>(record.status == ChargeStatus::ON) << 17);
+  Slot &slot = mSlots[mNext.fetch_add(1, std::memory_order_relaxed) % kMaxRecords];
+  const uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestamp.store(record.timestamp.count(), std::memory_order_relaxed);
+  slot.data.store(data, std::memory_order_relaxed);
+  slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+bool Telemetry::read(const Slot &slot, Record *out) const {
+  const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+  if (seq == 0 || (seq & 1))
+    return false;
+  const int64_t timestamp = slot.timestamp.load(std::memory_order_relaxed);
+  const uint32_t data = slot.data.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.seq.load(std::memory_order_relaxed) != seq)
+    return false;
+
+  out->timestamp = Duration(timestamp);
+  out->event = static_cast<Event>(data & 0xff);
+  out->capacity = (data >> 8) & 0xff;
+  out->statusKnown = (data >> 16) & 1;
+  out->status = ((data >> 17) & 1) ? ChargeStatus::ON : ChargeStatus::OFF;
+  return true;
+}
+
+void Telemetry::updateStatusTime(const Duration now, const bool known,
+                                 const ChargeStatus status) {
+  const int last = mLastStatus.load(std::memory_order_relaxed);
+  const int64_t since = mStatusSinceNs.load(std::memory_order_relaxed);
+  if (last >= 0 && since >= 0)
+    mTimeInStatusNs[last].fetch_add(now.count() - since, std::memory_order_relaxed);
+  mStatusSinceNs.store(now.count(), std::memory_order_relaxed);
+  mLastStatus.store(known ? static_cast<int>(status) : -1, std::memory_order_relaxed);
+}
+
+void Telemetry::recordSample(const Duration now, const HealthSample &sample) {
+  push({now, Event::SAMPLE, sample.capacity, sample.statusKnown, sample.status});
+  updateStatusTime(now, sample.statusKnown, sample.status);
+}
+
+void Telemetry::recordDecision(const Duration now, const int capacity,
+                               const ChargeStatus policy) {
+  push({now, Event::DECISION, capacity, true, policy});
+}
+
+void Telemetry::recordActuation(const Duration now, const ChargeStatus state) {
+  push({now, Event::ACTUATION, 0, true, state});
+  mActuations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Telemetry::recordWakeup(const WakeReason reason) {
+  mWakeups[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Telemetry::recordIterationCpu(const Duration cpu) {
+  const int64_t ns = cpu.count();
+  int64_t max = mCpuMaxNs.load(std::memory_order_relaxed);
+
+  mIterations.fetch_add(1, std::memory_order_relaxed);
+  mCpuTotalNs.fetch_add(ns, std::memory_order_relaxed);
+  while (ns > max &&
+         !mCpuMaxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    ;
+}
+
+void Telemetry::dumpStats(const int fd, const Duration now, const bool json) const {
+  const auto load = [](const auto &v) { return v.load(std::memory_order_relaxed); };
+  const uint64_t iterations = load(mIterations);
+  const int64_t cpuTotal = load(mCpuTotalNs);
+  int64_t timeIn[2] = {load(mTimeInStatusNs[0]), load(mTimeInStatusNs[1])};
+  const int last = load(mLastStatus);
+  const int64_t since = load(mStatusSinceNs);
+
+  // Account the status we are in right now as well
+  if (last >= 0 && since >= 0)
+    timeIn[last] += now.count() - since;
+
+  if (json) {
+    dprintf(fd,
+            "{\"wakeups\":{\"timer\":%llu,\"uevent\":%llu,\"notify\":%llu,"
+            "\"schedule\":%llu},"
+            "\"iterations\":%llu,\"actuations\":%llu,"
+            "\"cpu_us\":{\"total\":%lld,\"avg\":%lld,\"max\":%lld},"
+            "\"time_in_status_ms\":{\"on\":%lld,\"off\":%lld}}",
+            (unsigned long long)load(mWakeups[0]), (unsigned long long)load(mWakeups[1]),
+            (unsigned long long)load(mWakeups[2]), (unsigned long long)load(mWakeups[3]),
+            (unsigned long long)iterations,
+            (unsigned long long)load(mActuations), (long long)cpuTotal / 1000,
+            (long long)(iterations ? cpuTotal / iterations / 1000 : 0),
+            (long long)load(mCpuMaxNs) / 1000, (long long)toMillis(timeIn[ChargeStatus::ON]),
+            (long long)toMillis(timeIn[ChargeStatus::OFF]));
+    return;
+  }
+  dprintf(fd, "Wakeups (timer/uevent/notify/schedule): %llu %llu %llu %llu\n",
+          (unsigned long long)load(mWakeups[0]), (unsigned long long)load(mWakeups[1]),
+          (unsigned long long)load(mWakeups[2]), (unsigned long long)load(mWakeups[3]));
+  dprintf(fd, "Loop iterations: %llu, actuations: %llu\n",
+          (unsigned long long)iterations, (unsigned long long)load(mActuations));
+  dprintf(fd, "CPU time per iteration (avg/max): %lldus %lldus\n",
+          (long long)(iterations ? cpuTotal / iterations / 1000 : 0),
+          (long long)load(mCpuMaxNs) / 1000);
+  dprintf(fd, "Time in charge status (on/off): %llds %llds\n",
+          (long long)toMillis(timeIn[ChargeStatus::ON]) / 1000,
+          (long long)toMillis(timeIn[ChargeStatus::OFF]) / 1000);
+}
+
+void Telemetry::dumpRecords(const int fd, const bool json) const {
+  const uint64_t next = mNext.load(std::memory_order_acquire);
+  const uint64_t first = next > kMaxRecords ? next - kMaxRecords : 0;
+  bool comma = false;
+
+  if (json)
+    dprintf(fd, "[");
+  for (uint64_t i = first; i < next; ++i) {
+    Record record;
+    if (!read(mSlots[i % kMaxRecords], &record))
+      continue;
+    const long long ts = toMillis(record.timestamp.count());
+    const char *event = eventToString(record.event);
+    const char *status = statusToString(record.statusKnown, record.status);
+    if (json) {
+      if (record.event == Event::ACTUATION)
+        dprintf(fd, "%s{\"ts_ms\":%lld,\"event\":\"%s\",\"state\":\"%s\"}",
+                comma ? "," : "", ts, event, status);
+      else
+        dprintf(fd, "%s{\"ts_ms\":%lld,\"event\":\"%s\",\"capacity\":%d,\"status\":\"%s\"}",
+                comma ? "," : "", ts, event, record.capacity, status);
+      comma = true;
+    } else if (record.event == Event::ACTUATION) {
+      dprintf(fd, "%12lldms %-9s %s\n", ts, event, status);
+    } else {
+      dprintf(fd, "%12lldms %-9s %3d%% %s\n", ts, event, record.capacity, status);
+    }
+  }
+  if (json)
+    dprintf(fd, "]");
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "HealthSource.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Bounded, lock-free record of what the SmartCharge loop did recently.
+ *
+ * Recording is a handful of relaxed atomic stores, so it never blocks the
+ * recording thread. Readers (dump) detect and skip records that were being
+ * overwritten while they were reading.
+ */
+class Telemetry {
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  enum class Event : uint8_t {
+    // Health sample taken, with capacity and status
+    SAMPLE,
+    // Policy decided to change charge state
+    DECISION,
+    // Charge control node written
+    ACTUATION,
+  };
+
+  enum class WakeReason : uint8_t {
+    TIMER,
+    UEVENT,
+    // eventfd, e.g. pushed health info or config change
+    NOTIFY,
+    // Charge schedule boundary reached or wall clock set
+    SCHEDULE,
+    COUNT,
+  };
+
+  struct Record {
+    Duration timestamp;
+    Event event;
+    int capacity;
+    bool statusKnown;
+    ChargeStatus status;
+  };
+
+  void recordSample(const Duration now, const HealthSample &sample);
+  void recordDecision(const Duration now, const int capacity,
+                      const ChargeStatus policy);
+  void recordActuation(const Duration now, const ChargeStatus state);
+  void recordWakeup(const WakeReason reason);
+  void recordIterationCpu(const Duration cpu);
+
+  // Output for dumpsys, fd is written with dprintf
+  void dumpStats(const int fd, const Duration now, const bool json) const;
+  void dumpRecords(const int fd, const bool json) const;
+
+private:
+  static constexpr size_t kMaxRecords = 256;
+
+  struct Slot {
+    // Odd while being written
+    std::atomic<uint32_t> seq{0};
+    std::atomic<int64_t> timestamp{0};
+    // event | capacity | statusKnown | status, packed
+    std::atomic<uint32_t> data{0};
+  };
+
+  void push(const Record &record);
+  // Returns false if the slot was overwritten while reading
+  bool read(const Slot &slot, Record *out) const;
+  // Account time spent in the previous charge status
+  void updateStatusTime(const Duration now, const bool known,
+                        const ChargeStatus status);
+
+  std::array<Slot, kMaxRecords> mSlots;
+  std::atomic<uint64_t> mNext{0};
+
+  std::array<std::atomic<uint64_t>, static_cast<size_t>(WakeReason::COUNT)> mWakeups{};
+  std::atomic<uint64_t> mIterations{0};
+  std::atomic<uint64_t> mActuations{0};
+  std::atomic<int64_t> mCpuTotalNs{0};
+  std::atomic<int64_t> mCpuMaxNs{0};
+
+  // Indexed by ChargeStatus
+  std::array<std::atomic<int64_t>, 2> mTimeInStatusNs{};
+  std::atomic<int64_t> mStatusSinceNs{-1};
+  std::atomic<int> mLastStatus{-1};
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
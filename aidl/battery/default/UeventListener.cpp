@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "SmartChargeSvc::Uevent"
+
+#include "UeventListener.h"
+
+#include <SafeStoi.h>
+#include <log/log.h>
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using android::base::unique_fd;
+
+static constexpr size_t kUeventMsgLen = 4096;
+static constexpr int kUeventRcvBufSize = 64 * 1024;
+
+static constexpr std::string_view kSubsystemKey = "SUBSYSTEM=";
+static constexpr std::string_view kNameKey = "POWER_SUPPLY_NAME=";
+static constexpr std::string_view kCapacityKey = "POWER_SUPPLY_CAPACITY=";
+static constexpr std::string_view kStatusKey = "POWER_SUPPLY_STATUS=";
+static constexpr std::string_view kPowerSupply = "power_supply";
+static constexpr std::string_view kBattery = "battery";
+
+std::unique_ptr<UeventListener> UeventListener::openNetlink(void) {
+  struct sockaddr_nl addr = {};
+  int bufsize = kUeventRcvBufSize;
+
+  unique_fd fd(socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                      NETLINK_KOBJECT_UEVENT));
+  if (fd < 0) {
+    ALOGE("%s: socket: %s", __func__, strerror(errno));
+    return nullptr;
+  }
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+
+  addr.nl_family = AF_NETLINK;
+  addr.nl_pid = 0; // Let the kernel pick one
+  addr.nl_groups = 1; // Kernel uevent multicast group
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+    ALOGE("%s: bind: %s", __func__, strerror(errno));
+    return nullptr;
+  }
+  return std::make_unique<UeventListener>(std::move(fd));
+}
+
+UeventListener::UeventListener(unique_fd fd) : mFd(std::move(fd)) {}
+
+bool UeventListener::handleEvents(void) {
+  char buf[kUeventMsgLen];
+  bool changed = false;
+
+  while (true) {
+    struct sockaddr_nl addr = {};
+    struct iovec iov = {buf, sizeof(buf)};
+    struct msghdr hdr = {};
+
+    hdr.msg_name = &addr;
+    hdr.msg_namelen = sizeof(addr);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+
+    ssize_t n = TEMP_FAILURE_RETRY(recvmsg(mFd, &hdr, MSG_DONTWAIT));
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        ALOGE("%s: recvmsg: %s", __func__, strerror(errno));
+      break;
+    }
+    if (n == 0)
+      break;
+    // Netlink messages not coming from the kernel are spoofed, drop them.
+    if (hdr.msg_namelen >= sizeof(addr) && addr.nl_family == AF_NETLINK &&
+        addr.nl_pid != 0)
+      continue;
+    if (static_cast<size_t>(n) >= sizeof(buf)) {
+      ALOGW("%s: Dropping truncated uevent", __func__);
+      continue;
+    }
+    buf[n] = '\0';
+    changed |= parseMessage(buf, n);
+  }
+  return changed;
+}
+
+bool UeventListener::parseMessage(const char *msg, size_t len) {
+  std::string_view subsystem, name, capacity, status;
+  const char *end = msg + len;
+
+  // Message is "action@devpath\0KEY=VALUE\0KEY=VALUE\0..."
+  for (const char *p = msg; p < end; p += strlen(p) + 1) {
+    std::string_view kv(p);
+    if (kv.substr(0, kSubsystemKey.size()) == kSubsystemKey)
+      subsystem = kv.substr(kSubsystemKey.size());
+    else if (kv.substr(0, kNameKey.size()) == kNameKey)
+      name = kv.substr(kNameKey.size());
+    else if (kv.substr(0, kCapacityKey.size()) == kCapacityKey)
+      capacity = kv.substr(kCapacityKey.size());
+    else if (kv.substr(0, kStatusKey.size()) == kStatusKey)
+      status = kv.substr(kStatusKey.size());
+  }
+  if (subsystem != kPowerSupply || name != kBattery)
+    return false;
+
+  bool changed = false;
+  if (!capacity.empty()) {
+    const int cap = stoi_safe(std::string(capacity));
+    if (cap >= 0 && cap != mCapacity) {
+      mCapacity = cap;
+      changed = true;
+    }
+  }
+  if (!status.empty() && status != mStatus) {
+    mStatus = status;
+    changed = true;
+  }
+  return changed;
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
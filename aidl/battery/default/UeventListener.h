@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <memory>
+#include <string>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+/**
+ * Listens for kernel uevents of the battery power_supply device.
+ *
+ * The listener does not care where the datagrams come from, so anything
+ * delivering kobject uevent formatted messages (e.g. one end of a
+ * socketpair(2)) can be injected in place of the netlink socket.
+ */
+class UeventListener {
+public:
+  // Opens and binds a NETLINK_KOBJECT_UEVENT socket, returns null on failure.
+  static std::unique_ptr<UeventListener> openNetlink(void);
+
+  // Takes ownership of an already set up datagram socket.
+  explicit UeventListener(::android::base::unique_fd fd);
+
+  // Fd to poll(2) for POLLIN.
+  int getFd(void) const { return mFd.get(); }
+
+  /**
+   * Drain all pending uevents without blocking.
+   *
+   * @return true if capacity or status of the battery changed since
+   * the last call.
+   */
+  bool handleEvents(void);
+
+private:
+  // Returns true if the message changed the cached battery state.
+  bool parseMessage(const char *msg, size_t len);
+
+  ::android::base::unique_fd mFd;
+  int mCapacity = -1;
+  std::string mStatus;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
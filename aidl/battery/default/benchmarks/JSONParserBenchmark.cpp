@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Device entry lookup in a synthetic smartcharge_nodes.json of 10k entries,
+// the linear scan ConfigParser used to do against its index. Run once per
+// mode, peak RSS is per process.
+
+#include "JSONParser.hpp"
+
+#include <json/json.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr int kEntries = 10000;
+static constexpr int kLookups = 1000;
+
+static void generate(const std::string &path) {
+  Json::Value root(Json::arrayValue);
+
+  for (int i = 0; i < kEntries; ++i) {
+    Json::Value device;
+    device["codename"] = "device" + std::to_string(i);
+    device["vendor"] = "vendor" + std::to_string(i % 100);
+    for (const char *type : {"enable", "disable"}) {
+      Json::Value action;
+      action["action"] = type;
+      action["node"] = "/dev/null";
+      action["handler"] = "WriteFile";
+      action["handler_data"] = type[0] == 'e' ? "0" : "1";
+      device["actions"].append(action);
+    }
+    root.append(device);
+  }
+  std::ofstream(path) << root;
+}
+
+enum class MatchQuality { EXACT, MATCHES_VENDOR, NO_MATCH };
+
+// ConfigParser::lookupEntry before the index, copies included
+static std::pair<Json::Value, MatchQuality>
+linearLookup(const Json::Value &root, const ConfigParser::SearchEntry &search) {
+  std::pair<Json::Value, MatchQuality> current = {root, MatchQuality::NO_MATCH};
+  for (const auto &devices : root) {
+    if (devices["codename"].asString() == search.codename) {
+      current = {devices, MatchQuality::EXACT};
+      break;
+    }
+    if (devices["vendor"].asString() == search.vendor) {
+      current = {devices, MatchQuality::MATCHES_VENDOR};
+    }
+  }
+  return current;
+}
+
+static long peakRssKiB(void) {
+  struct rusage usage = {};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+int main(int argc, char **argv) {
+  const bool linear = argc > 1 && strcmp(argv[1], "--linear") == 0;
+  const std::string path = argc > 2 ? argv[2] : "/tmp/smartcharge_nodes_bench.json";
+  // Worst case for a scan: the last entry, and a vendor only match
+  const ConfigParser::SearchEntry searches[] = {
+      {"device" + std::to_string(kEntries - 1), ""},
+      {"unknown", "vendor42"},
+  };
+  size_t found = 0;
+
+  if (argc > 1 && !linear && strcmp(argv[1], "--indexed") != 0) {
+    fprintf(stderr, "Usage: %s [--linear|--indexed] [file]\n", argv[0]);
+    return 1;
+  }
+  if (access(path.c_str(), R_OK) != 0)
+    generate(path);
+
+  const auto parseStart = Clock::now();
+  Json::Value root;
+  std::unique_ptr<ConfigParser> parser;
+  if (linear) {
+    std::ifstream file(path);
+    file >> root;
+  } else {
+    parser = std::make_unique<ConfigParser>(path);
+  }
+  const auto parseEnd = Clock::now();
+
+  for (int i = 0; i < kLookups; ++i) {
+    const auto &search = searches[i % std::size(searches)];
+    if (linear)
+      found += linearLookup(root, search).second != MatchQuality::NO_MATCH;
+    else
+      found += parser->findEntry(search) != nullptr;
+  }
+  const auto lookupEnd = Clock::now();
+
+  using std::chrono::duration;
+  printf("%s: %d entries, parse %.1f ms, lookup avg %.2f us, peak RSS %ld KiB, %zu/%d found\n",
+         linear ? "linear" : "indexed", kEntries,
+         duration<double, std::milli>(parseEnd - parseStart).count(),
+         duration<double, std::micro>(lookupEnd - parseEnd).count() / kLookups, peakRssKiB(),
+         found, kLookups);
+  return found == kLookups ? 0 : 1;
+}
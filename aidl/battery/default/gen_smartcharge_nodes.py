@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2024 Royna (@roynatech2544 on GH)
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+"""Validate smartcharge_nodes.json and compile it into a constexpr C++ table.
+
+Usage: gen_smartcharge_nodes.py <smartcharge_nodes.json> <output header>
+"""
+
+import json
+import sys
+
+ACTIONS = ('enable', 'disable')
+# Firmware enforced charge cap, optional
+OFFLOAD = 'offload'
+HANDLERS = {
+    'OpenFile': 'ActionPlan::Handler::OPEN_FILE',
+    'WriteFile': 'ActionPlan::Handler::WRITE_FILE',
+}
+
+
+class SchemaError(Exception):
+    pass
+
+
+def expect_string(obj, key, where, required=True):
+    if key not in obj:
+        if required:
+            raise SchemaError(f'{where}: missing "{key}"')
+        return None
+    if not isinstance(obj[key], str) or not obj[key]:
+        raise SchemaError(f'{where}: "{key}" must be a non-empty string')
+    return obj[key]
+
+
+def validate_levels(action, where):
+    levels = action.get('levels')
+    if not isinstance(levels, list) or not levels:
+        raise SchemaError(f'{where}: "levels" must be a non-empty array')
+    for level in levels:
+        # SmartCharge takes no upper limit above 95
+        if not isinstance(level, int) or isinstance(level, bool) \
+                or not 0 < level <= 95:
+            raise SchemaError(f'{where}: level {level!r} out of range')
+    if len(set(levels)) != len(levels):
+        raise SchemaError(f'{where}: duplicate levels')
+    return levels
+
+
+def validate_action(action, where):
+    if not isinstance(action, dict):
+        raise SchemaError(f'{where}: action must be an object')
+    kind = expect_string(action, 'action', where)
+    if kind not in ACTIONS + (OFFLOAD,):
+        raise SchemaError(f'{where}: unknown action "{kind}"')
+    node = expect_string(action, 'node', where)
+    if not node.startswith('/'):
+        raise SchemaError(f'{where}: node "{node}" must be an absolute path')
+    handler = expect_string(action, 'handler', where)
+    if handler not in HANDLERS:
+        raise SchemaError(f'{where}: unknown handler "{handler}"')
+    if kind == OFFLOAD and handler != 'WriteFile':
+        raise SchemaError(f'{where}: "{OFFLOAD}" needs handler "WriteFile"')
+    data = expect_string(action, 'handler_data', where,
+                         required=handler == 'WriteFile')
+    # Cap is written as its level, handler_data lifts it
+    levels = validate_levels(action, where) if kind == OFFLOAD else None
+    return kind, node, handler, data or '', levels
+
+
+def validate(root):
+    if not isinstance(root, list):
+        raise SchemaError('top level must be an array of devices')
+    devices = []
+    for i, device in enumerate(root):
+        where = f'device #{i}'
+        if not isinstance(device, dict):
+            raise SchemaError(f'{where}: must be an object')
+        codename = expect_string(device, 'codename', where, required=False)
+        vendor = expect_string(device, 'vendor', where, required=False)
+        if codename is None and vendor is None:
+            raise SchemaError(f'{where}: needs "codename" or "vendor"')
+        actions = device.get('actions')
+        if not isinstance(actions, list):
+            raise SchemaError(f'{where}: "actions" must be an array')
+        compiled = [validate_action(a, f'{where} action #{j}')
+                    for j, a in enumerate(actions)]
+        for kind in ACTIONS:
+            if [a[0] for a in compiled].count(kind) != 1:
+                raise SchemaError(f'{where}: needs exactly one "{kind}" action')
+        offload = [a for a in compiled if a[0] == OFFLOAD]
+        if len(offload) > 1:
+            raise SchemaError(f'{where}: at most one "{OFFLOAD}" action')
+        devices.append((codename or '', vendor or '',
+                        [a for a in compiled if a[0] != OFFLOAD],
+                        offload[0] if offload else None))
+    return devices
+
+
+def cstr(value):
+    out = '"'
+    for c in value:
+        if c in '"\\':
+            out += '\\' + c
+        elif 0x20 <= ord(c) < 0x7f:
+            out += c
+        else:
+            out += ''.join(f'\\{b:03o}' for b in c.encode('utf-8'))
+    return out + '"'
+
+
+def emit(devices, src):
+    lines = [
+        f'// Generated by gen_smartcharge_nodes.py from {src}, do not edit.',
+        '',
+        '#pragma once',
+        '',
+        '#include "DeviceDatabase.h"',
+        '',
+        'namespace aidl {',
+        'namespace vendor {',
+        'namespace samsung_ext {',
+        'namespace framework {',
+        'namespace battery {',
+        '',
+    ]
+    for i, (_, _, actions, offload) in enumerate(devices):
+        lines.append(f'inline constexpr CompiledAction kCompiledActions{i}[] = {{')
+        for kind, node, handler, data, _ in actions:
+            lines.append(f'    {{{"true" if kind == "enable" else "false"}, '
+                         f'{HANDLERS[handler]}, {cstr(node)}, {cstr(data)}}},')
+        lines.append('};')
+        if offload is not None:
+            _, node, _, data, levels = offload
+            lines.append(f'inline constexpr int kOffloadLevels{i}[] = {{'
+                         f'{", ".join(str(l) for l in levels)}}};')
+            lines.append(f'inline constexpr CompiledOffload kCompiledOffload{i} = {{'
+                         f'{cstr(node)}, {cstr(data)}, kOffloadLevels{i}, '
+                         f'{len(levels)}}};')
+    lines.append('')
+    lines.append('inline constexpr CompiledDevice kCompiledDevices[] = {')
+    for i, (codename, vendor, actions, offload) in enumerate(devices):
+        offload_ref = f'&kCompiledOffload{i}' if offload is not None else 'nullptr'
+        lines.append(f'    {{{cstr(codename)}, {cstr(vendor)}, '
+                     f'kCompiledActions{i}, {len(actions)}, {offload_ref}}},')
+    lines += [
+        '};',
+        '',
+        '} // namespace battery',
+        '} // namespace framework',
+        '} // namespace samsung_ext',
+        '} // namespace vendor',
+        '} // namespace aidl',
+        '',
+    ]
+    return '\n'.join(lines)
+
+
+def main(argv):
+    if len(argv) != 3:
+        print(__doc__, file=sys.stderr)
+        return 1
+    try:
+        with open(argv[1]) as f:
+            devices = validate(json.load(f))
+    except (json.JSONDecodeError, SchemaError) as e:
+        print(f'{argv[1]}: {e}', file=sys.stderr)
+        return 1
+    with open(argv[2], 'w') as f:
+        f.write(emit(devices, 'smartcharge_nodes.json'))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -9,14 +9,18 @@
 #include <android-base/logging.h>
 #include <android/binder_manager.h>
 #include <android/binder_process.h>
+#include <hidl/HidlTransportSupport.h>
 
 using ::aidl::vendor::samsung_ext::framework::battery::SmartCharge;
 
 int main(int argc, char **argv) {
   android::base::InitLogging(argv);
  
-  ABinderProcess_setThreadPoolMaxThreadCount(8);
-  ABinderProcess_startThreadPool();
+  // Calls only update state and wake the reactor, so the main thread alone
+  // serves them, health HAL callbacks and death notifications
+  ABinderProcess_setThreadPoolMaxThreadCount(0);
+  // For health HIDL HAL callbacks
+  android::hardware::configureRpcThreadpool(1, false /* callerWillJoin */);
   std::shared_ptr<SmartCharge> smartcharge =
       ndk::SharedRefBase::make<SmartCharge>();
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "UeventListener.h"
+
+#include <gtest/gtest.h>
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+using aidl::vendor::samsung_ext::framework::battery::UeventListener;
+using android::base::unique_fd;
+
+namespace {
+
+// kobject uevent message, "action@devpath" followed by KEY=VALUE, each NUL
+// terminated
+std::string makeUevent(const std::string &subsystem, const std::string &name,
+                       const std::string &capacity, const std::string &status) {
+  std::string msg = "change@/devices/platform/battery/power_supply/" + name;
+  msg += '\0';
+  for (const auto &kv : {"SUBSYSTEM=" + subsystem, "POWER_SUPPLY_NAME=" + name,
+                         "POWER_SUPPLY_CAPACITY=" + capacity,
+                         "POWER_SUPPLY_STATUS=" + status}) {
+    msg += kv;
+    msg += '\0';
+  }
+  return msg;
+}
+
+class UeventListenerTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, fds), 0);
+    mSender.reset(fds[0]);
+    mListener = std::make_unique<UeventListener>(unique_fd(fds[1]));
+  }
+
+  void send(const std::string &msg) {
+    ASSERT_EQ(write(mSender, msg.data(), msg.size()), static_cast<ssize_t>(msg.size()));
+  }
+
+  unique_fd mSender;
+  std::unique_ptr<UeventListener> mListener;
+};
+
+TEST_F(UeventListenerTest, CapacityChange) {
+  send(makeUevent("power_supply", "battery", "50", "Charging"));
+  EXPECT_TRUE(mListener->handleEvents());
+  // Same state again, e.g. temperature changed
+  send(makeUevent("power_supply", "battery", "50", "Charging"));
+  EXPECT_FALSE(mListener->handleEvents());
+  send(makeUevent("power_supply", "battery", "51", "Charging"));
+  EXPECT_TRUE(mListener->handleEvents());
+  send(makeUevent("power_supply", "battery", "51", "Discharging"));
+  EXPECT_TRUE(mListener->handleEvents());
+}
+
+TEST_F(UeventListenerTest, DrainsAllPending) {
+  send(makeUevent("power_supply", "battery", "50", "Charging"));
+  send(makeUevent("power_supply", "battery", "51", "Charging"));
+  EXPECT_TRUE(mListener->handleEvents());
+  // Nothing left, returns without blocking
+  EXPECT_FALSE(mListener->handleEvents());
+}
+
+TEST_F(UeventListenerTest, IgnoresOtherSubsystems) {
+  send(makeUevent("usb", "battery", "50", "Charging"));
+  EXPECT_FALSE(mListener->handleEvents());
+  send(makeUevent("power_supply", "usb", "50", "Charging"));
+  EXPECT_FALSE(mListener->handleEvents());
+}
+
+TEST_F(UeventListenerTest, DropsTruncatedMessage) {
+  std::string msg = makeUevent("power_supply", "battery", "50", "Charging");
+  // Longer than the receive buffer, the tail is cut off
+  msg.resize(8192, 'x');
+  send(msg);
+  EXPECT_FALSE(mListener->handleEvents());
+  // Only that one is dropped
+  send(makeUevent("power_supply", "battery", "50", "Charging"));
+  EXPECT_TRUE(mListener->handleEvents());
+}
+
+TEST_F(UeventListenerTest, LastFieldWithoutTerminator) {
+  std::string msg = makeUevent("power_supply", "battery", "50", "Charging");
+  msg.pop_back();
+  send(msg);
+  EXPECT_TRUE(mListener->handleEvents());
+}
+
+// Spoofing needs a netlink sender, a socketpair has no nl_pid
+TEST(UeventListenerNetlinkTest, DropsUserspaceSender) {
+  struct sockaddr_nl addr = {};
+  socklen_t len = sizeof(addr);
+
+  addr.nl_family = AF_NETLINK;
+  unique_fd listenFd(socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                            NETLINK_KOBJECT_UEVENT));
+  unique_fd sendFd(socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT));
+  if (listenFd < 0 || sendFd < 0)
+    GTEST_SKIP() << "No NETLINK_KOBJECT_UEVENT sockets here";
+  ASSERT_EQ(bind(listenFd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)), 0);
+  ASSERT_EQ(bind(sendFd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)), 0);
+  ASSERT_EQ(getsockname(listenFd, reinterpret_cast<struct sockaddr *>(&addr), &len), 0);
+  ASSERT_NE(addr.nl_pid, 0u);
+
+  UeventListener listener(std::move(listenFd));
+  const std::string msg = makeUevent("power_supply", "battery", "50", "Charging");
+  // Unicast from a process, nl_pid of the sender is its port
+  ASSERT_EQ(sendto(sendFd, msg.data(), msg.size(), 0,
+                   reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)),
+            static_cast<ssize_t>(msg.size()));
+  EXPECT_FALSE(listener.handleEvents());
+}
+
+} // namespace
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "Simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using Hours = duration<double, std::ratio<3600>>;
+
+// Rounding slack when a capacity change is reached exactly
+static constexpr double kEpsilon = 1e-9;
+
+// Fast constant current phase, then tapering off towards full
+static double syntheticChargeRate(const int capacity) {
+  if (capacity < 70)
+    return 45;
+  if (capacity < 90)
+    return 25;
+  return 10;
+}
+
+BatteryModel::BatteryModel(const int capacity, const double dischargeRate)
+    : mDischargeRate(dischargeRate), mCapacity(std::clamp(capacity, 0, 100)) {
+  for (size_t i = 0; i < mChargeRate.size(); ++i)
+    mChargeRate[i] = syntheticChargeRate(i);
+}
+
+bool BatteryModel::loadChargeCurve(const std::string &path) {
+  std::ifstream file(path);
+  std::array<double, 101> firstSeen;
+  std::array<double, 101> rate;
+  std::string line;
+
+  if (!file)
+    return false;
+  firstSeen.fill(-1);
+  rate.fill(0);
+  while (std::getline(file, line)) {
+    double seconds;
+    int capacity;
+    if (line.empty() || line[0] == '#')
+      continue;
+    if (sscanf(line.c_str(), "%lf,%d", &seconds, &capacity) != 2 ||
+        capacity < 0 || capacity > 100)
+      continue;
+    if (firstSeen[capacity] < 0)
+      firstSeen[capacity] = seconds;
+  }
+  // Time from reaching one percent to reaching the next
+  bool found = false;
+  for (size_t i = 0; i + 1 < firstSeen.size(); ++i) {
+    if (firstSeen[i] < 0 || firstSeen[i + 1] <= firstSeen[i])
+      continue;
+    rate[i] = 3600 / (firstSeen[i + 1] - firstSeen[i]);
+    found = true;
+  }
+  if (!found)
+    return false;
+  // Outside of the recorded range, keep the nearest recorded rate
+  double last = 0;
+  for (size_t i = 0; i < rate.size(); ++i) {
+    if (rate[i] > 0)
+      last = rate[i];
+    else if (last > 0)
+      rate[i] = last;
+  }
+  for (size_t i = rate.size(); i-- > 0;) {
+    if (rate[i] > 0)
+      last = rate[i];
+    else
+      rate[i] = last;
+  }
+  mChargeRate = rate;
+  return true;
+}
+
+void BatteryModel::setCharging(const bool charging) {
+  if (mCharging == charging)
+    return;
+  // Same physical charge level, seen from the other direction
+  if (mProgress > 0)
+    mProgress = 1 - mProgress;
+  mCharging = charging;
+}
+
+HealthSample BatteryModel::getSample(void) const {
+  return {mCapacity, true, mCharging ? ChargeStatus::ON : ChargeStatus::OFF, true, true};
+}
+
+double BatteryModel::currentRate(void) const {
+  if (mCharging)
+    return mCapacity < 100 ? mChargeRate[mCapacity] : 0;
+  return mCapacity > 0 ? mDischargeRate : 0;
+}
+
+BatteryModel::Duration BatteryModel::timeToNextChange(void) const {
+  const double rate = currentRate();
+  if (rate <= 0)
+    return Duration::max();
+  return duration_cast<Duration>(Hours((1 - mProgress) / rate));
+}
+
+void BatteryModel::advance(const Duration dt) {
+  mProgress += currentRate() * Hours(dt).count();
+  if (mProgress < 1 - kEpsilon)
+    return;
+  mCapacity += mCharging ? 1 : -1;
+  mProgress = 0;
+}
+
+void FakeChargeNode::apply(const Duration now, const bool enable) {
+  if (mLastApplied == enable)
+    return;
+  mLastApplied = enable;
+  mWrites.push_back({now, enable});
+  if (mEnabled != enable)
+    ++mToggles;
+  mEnabled = enable;
+  mOnWrite(enable);
+}
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <ChargeController.h>
+#include <HealthSource.h>
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace aidl {
+namespace vendor {
+namespace samsung_ext {
+namespace framework {
+namespace battery {
+
+// Clock that only moves when told to
+class SimClock : public Clock {
+public:
+  // Wall clock starts at the given time of day
+  explicit SimClock(const Duration startOfDay = Duration(0)) : mStartOfDay(startOfDay) {}
+
+  Duration now(void) const override { return mNow; }
+  Duration sinceLocalMidnight(void) const override {
+    return (mStartOfDay + mNow) % std::chrono::hours(24);
+  }
+  void advance(const Duration dt) { mNow += dt; }
+
+private:
+  Duration mStartOfDay;
+  Duration mNow{0};
+};
+
+/**
+ * Battery on a charger, charging or not as the charge control node says.
+ *
+ * Charge rate depends on capacity, either from a synthetic CC/CV-like
+ * curve or replayed from a recorded charge session. With charging disabled
+ * the device runs from the battery at a constant discharge rate.
+ */
+class BatteryModel {
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  BatteryModel(const int capacity, const double dischargeRate);
+
+  /**
+   * Replace the synthetic charge curve with a recorded one.
+   *
+   * @param path Text file with "seconds,capacity" lines of one charge session
+   * @return false if the file cannot be read or has no capacity increase
+   */
+  bool loadChargeCurve(const std::string &path);
+
+  void setCharging(const bool charging);
+  HealthSample getSample(void) const;
+  int getCapacity(void) const { return mCapacity; }
+
+  // Time until capacity changes, Duration::max() if it never does
+  Duration timeToNextChange(void) const;
+  // Let time pass, dt must not exceed timeToNextChange()
+  void advance(const Duration dt);
+
+private:
+  // Rate capacity changes at right now, percent per hour
+  double currentRate(void) const;
+
+  // Indexed by capacity, percent per hour
+  std::array<double, 101> mChargeRate;
+  double mDischargeRate;
+  int mCapacity;
+  // Way to the next capacity change in the current direction, 0 to 1
+  double mProgress = 0;
+  bool mCharging = true;
+};
+
+/**
+ * Charge control node that records what is written to it, applied the same
+ * way ActionPlan does: repeated writes of the same state are skipped until
+ * invalidated.
+ */
+class FakeChargeNode {
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  struct Write {
+    Duration timestamp;
+    bool enable;
+  };
+
+  explicit FakeChargeNode(std::function<void(bool)> onWrite)
+      : mOnWrite(std::move(onWrite)) {}
+
+  void apply(const Duration now, const bool enable);
+  void invalidate(void) { mLastApplied = kUnknown; }
+
+  const std::vector<Write> &getWrites(void) const { return mWrites; }
+  // Writes that actually changed the charge state
+  size_t getToggles(void) const { return mToggles; }
+
+private:
+  static constexpr int kUnknown = -1;
+
+  std::function<void(bool)> mOnWrite;
+  std::vector<Write> mWrites;
+  size_t mToggles = 0;
+  int mLastApplied = kUnknown;
+  // Node state, charging is enabled on boot
+  bool mEnabled = true;
+};
+
+} // namespace battery
+} // namespace framework
+} // namespace samsung_ext
+} // namespace vendor
+} // namespace aidl
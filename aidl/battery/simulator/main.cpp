@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "Simulator.h"
+
+#include <ChargeController.h>
+#include <ChargeSchedule.h>
+#include <HealthSource.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+using namespace aidl::vendor::samsung_ext::framework::battery;
+using namespace std::chrono_literals;
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using Duration = std::chrono::nanoseconds;
+using Hours = duration<double, std::ratio<3600>>;
+
+// Charger status change reaches the loop as uevent this late after a write
+static constexpr auto kUeventLatency = 1s;
+
+struct Options {
+  double hours = 8;
+  double speed = 1000;
+  int capacity = 40;
+  double dischargeRate = 1;
+  ChargeConfig config = {80, 75, true};
+  bool eventDriven = true;
+  bool trace = false;
+  const char *curve = nullptr;
+  // Minutes since midnight on plug in
+  int startMinute = 22 * 60;
+  std::vector<ChargeSchedule::Window> schedule;
+};
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  --hours H        Simulated time, default 8\n"
+          "  --speed N        Times faster than real time, 0 for no pacing, "
+          "default 1000\n"
+          "  --capacity N     Capacity on plug in, default 40\n"
+          "  --discharge R    Discharge rate with charging disabled, %%/h, "
+          "default 1\n"
+          "  --upper N        Upper limit, default 80\n"
+          "  --lower N        Lower limit, -1 for none, default 75\n"
+          "  --no-restart     Do not restart charging below lower limit\n"
+          "  --poll           No uevents, loop only wakes on its timer\n"
+          "  --curve FILE     Replay charge rate from \"seconds,capacity\" "
+          "lines of a recorded charge session\n"
+          "  --start HH:MM    Time of day on plug in, default 22:00\n"
+          "  --schedule S     Charge schedule as persisted by the service, "
+          "e.g. 0000-0500:80:-1,0500-0700:100:-1\n"
+          "  --trace          Print every charge control node write\n"
+          "\n"
+          "Runs the charge policy and wakeup scheduling of the service. Node\n"
+          "writes always take effect, so actuation retries are never needed,\n"
+          "and firmware charge caps are not simulated.\n",
+          argv0);
+}
+
+static bool parseNumber(const char *str, double *out) {
+  char *end;
+  *out = strtod(str, &end);
+  return end != str && *end == '\0';
+}
+
+static bool parseOptions(int argc, const char **argv, Options *opts) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    double value;
+
+    if (strcmp(arg, "--no-restart") == 0) {
+      opts->config.restart = false;
+      continue;
+    } else if (strcmp(arg, "--poll") == 0) {
+      opts->eventDriven = false;
+      continue;
+    } else if (strcmp(arg, "--trace") == 0) {
+      opts->trace = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+      return false;
+    if (strcmp(arg, "--curve") == 0) {
+      opts->curve = argv[++i];
+      continue;
+    } else if (strcmp(arg, "--start") == 0) {
+      int h, m;
+      if (sscanf(argv[++i], "%d:%d", &h, &m) != 2 || h < 0 || h > 23 || m < 0 || m > 59)
+        return false;
+      opts->startMinute = h * 60 + m;
+      continue;
+    } else if (strcmp(arg, "--schedule") == 0) {
+      if (!ChargeSchedule::fromString(argv[++i], &opts->schedule))
+        return false;
+      continue;
+    }
+    if (!parseNumber(argv[++i], &value))
+      return false;
+    if (strcmp(arg, "--hours") == 0)
+      opts->hours = value;
+    else if (strcmp(arg, "--speed") == 0)
+      opts->speed = value;
+    else if (strcmp(arg, "--discharge") == 0)
+      opts->dischargeRate = value;
+    else if (strcmp(arg, "--capacity") == 0)
+      opts->capacity = value;
+    else if (strcmp(arg, "--upper") == 0)
+      opts->config.upper = value;
+    else if (strcmp(arg, "--lower") == 0)
+      opts->config.lower = value;
+    else
+      return false;
+  }
+  return opts->hours > 0 && opts->speed >= 0;
+}
+
+static Duration threadCpuTime(void) {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+static double toSeconds(const Duration d) {
+  return duration<double>(d).count();
+}
+
+int main(int argc, const char **argv) {
+  Options opts;
+  if (!parseOptions(argc, argv, &opts)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  SimClock clock(std::chrono::minutes(opts.startMinute));
+  BatteryModel battery(opts.capacity, opts.dischargeRate);
+  FakeHealthSource health;
+  bool statusUevent = false;
+  FakeChargeNode node([&](const bool enable) {
+    battery.setCharging(enable);
+    statusUevent = true;
+  });
+  ChargeController controller(clock);
+  ChargeSchedule schedule;
+
+  if (opts.curve && !battery.loadChargeCurve(opts.curve)) {
+    fprintf(stderr, "Failed to load charge curve from %s\n", opts.curve);
+    return 1;
+  }
+  if (!schedule.setWindows(opts.schedule)) {
+    fprintf(stderr, "Invalid schedule\n");
+    return 1;
+  }
+
+  const Duration end = duration_cast<Duration>(Hours(opts.hours));
+  const auto wallStart = std::chrono::steady_clock::now();
+  const int startCapacity = battery.getCapacity();
+  Duration cpu{0}, aboveUpper{0};
+  size_t timerWakeups = 0, ueventWakeups = 0, scheduleWakeups = 0;
+  size_t scheduleLookups = 0;
+  const ChargeSchedule::Window *window = nullptr;
+  Duration nextBoundary{0};
+
+  // Policy steps of SmartCharge::evaluate, with sleeping simulated. Its
+  // actuation retries and firmware offload are not part of it.
+  controller.reset();
+  while (clock.now() < end) {
+    HealthSample sample;
+
+    health.setSample(battery.getSample());
+    const auto cpuStart = threadCpuTime();
+    health.read(&sample);
+    // Window is only looked up when its boundary timer fires
+    if (clock.now() >= nextBoundary) {
+      const auto sinceMidnight = clock.sinceLocalMidnight();
+      const auto left = schedule.timeToNextBoundary(sinceMidnight);
+      window = schedule.lookup(sinceMidnight);
+      nextBoundary = left == Duration::max() ? Duration::max() : clock.now() + left;
+      ++scheduleLookups;
+    }
+    const auto config = ChargeSchedule::apply(opts.config, window);
+    const auto step = controller.step(sample, config, opts.eventDriven);
+    if (step.statusChanged)
+      node.invalidate();
+    if (step.actuate)
+      node.apply(clock.now(), step.policy == ChargeStatus::ON);
+    cpu += threadCpuTime() - cpuStart;
+
+    // Sleep until the timer fires, or a capacity or status uevent comes
+    Duration wake = clock.now() + step.wakeInterval;
+    bool uevent = false, boundary = false;
+    if (nextBoundary < wake) {
+      wake = nextBoundary;
+      boundary = true;
+    }
+    if (opts.eventDriven) {
+      const Duration change = statusUevent ? Duration(kUeventLatency)
+                                           : battery.timeToNextChange();
+      if (change != Duration::max() && clock.now() + change < wake) {
+        wake = clock.now() + change;
+        uevent = true;
+        boundary = false;
+      }
+    }
+    statusUevent = false;
+    wake = std::min(wake, end);
+    while (clock.now() < wake) {
+      const Duration dt = std::min(wake - clock.now(), battery.timeToNextChange());
+      if (battery.getCapacity() > config.upper)
+        aboveUpper += dt;
+      battery.advance(dt);
+      clock.advance(dt);
+    }
+    if (opts.speed > 0)
+      std::this_thread::sleep_until(
+          wallStart + duration_cast<std::chrono::steady_clock::duration>(
+                          duration<double, std::nano>(clock.now().count() / opts.speed)));
+    if (clock.now() < end)
+      ++(uevent ? ueventWakeups : boundary ? scheduleWakeups : timerWakeups);
+  }
+
+  if (opts.trace) {
+    for (const auto &write : node.getWrites())
+      printf("%10.1fs write %s\n", toSeconds(write.timestamp),
+             write.enable ? "enable" : "disable");
+  }
+  const double hours = opts.hours;
+  const size_t wakeups = timerWakeups + ueventWakeups + scheduleWakeups;
+  printf("Simulated %.2fh at %gx, wakeups from %s\n", hours, opts.speed,
+         opts.eventDriven ? "uevent" : "polling");
+  printf("Configuration (upper/lower/restart): %d %d %d\n", opts.config.upper,
+         opts.config.lower, opts.config.restart);
+  if (!schedule.empty())
+    printf("Schedule: %s, %zu lookups\n", schedule.toString().c_str(), scheduleLookups);
+  printf("Capacity (start/end): %d%% %d%%\n", startCapacity, battery.getCapacity());
+  printf("Toggles: %zu (node writes: %zu)\n", node.getToggles(),
+         node.getWrites().size());
+  printf("Time above upper: %.0fs\n", toSeconds(aboveUpper));
+  printf("Wakeups: %zu (%.1f/h), timer %zu, uevent %zu, schedule %zu\n", wakeups,
+         wakeups / hours, timerWakeups, ueventWakeups, scheduleWakeups);
+  printf("Loop CPU time: %.0fus (%.1fus/h)\n", toSeconds(cpu) * 1e6,
+         toSeconds(cpu) * 1e6 / hours);
+  printf("Wall time: %.2fs\n",
+         duration<double>(std::chrono::steady_clock::now() - wallStart).count());
+  return 0;
+}
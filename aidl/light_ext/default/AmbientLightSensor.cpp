@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "vendor.samsung_ext.hardware.lights-service"
+
+#include "AmbientLightSensor.h"
+
+#include <android-base/logging.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+using ::android::base::unique_fd;
+
+static const char IIO_DEVICE_PREFIX[] = "/dev/iio:device";
+static const char IIO_SYSFS_DIR[] = "/sys/bus/iio/devices";
+// Scan element of the illuminance channel, e.g. in_illuminance_en
+static const char ILLUMINANCE_PREFIX[] = "in_illuminance";
+
+template <typename T>
+static bool readValue(const std::string& path, T* value) {
+    std::ifstream file(path);
+    file >> *value;
+    return !file.fail();
+}
+
+static bool writeValue(const std::string& path, const char* value) {
+    std::ofstream file(path);
+    file << value;
+    file.flush();
+    if (file.fail()) {
+        LOG(ERROR) << "Failed to write " << value << " to " << path;
+        return false;
+    }
+    return true;
+}
+
+static bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static std::vector<std::string> listDir(const std::string& dir) {
+    std::vector<std::string> names;
+    DIR* d = opendir(dir.c_str());
+
+    if (!d) return names;
+    while (struct dirent* entry = readdir(d)) names.push_back(entry->d_name);
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Scan element of the illuminance channel, without the _en suffix
+static std::string findIlluminanceElement(const std::string& scanDir) {
+    for (const auto& name : listDir(scanDir)) {
+        if (name.rfind(ILLUMINANCE_PREFIX, 0) == 0 && endsWith(name, "_en"))
+            return name.substr(0, name.size() - 3);
+    }
+    return "";
+}
+
+std::string AmbientLightSensor::findIioDevice() {
+    for (const auto& name : listDir(IIO_SYSFS_DIR)) {
+        if (name.rfind("iio:device", 0) != 0) continue;
+        const std::string scanDir = std::string(IIO_SYSFS_DIR) + "/" + name + "/scan_elements";
+        if (!findIlluminanceElement(scanDir).empty()) return std::string("/dev/") + name;
+    }
+    return "";
+}
+
+namespace {
+struct ChannelType {
+    bool bigEndian;
+    bool isSigned;
+    unsigned bits;
+    unsigned storageBits;
+    unsigned repeat;
+    unsigned shift;
+};
+}  // namespace
+
+// e.g. "le:u12/16>>4" or "be:s16/16X2>>0"
+static bool readChannelType(const std::string& path, ChannelType* type) {
+    std::string str;
+    char endian, sign;
+
+    if (!readValue(path, &str)) return false;
+    type->repeat = 1;
+    if (sscanf(str.c_str(), "%ce:%c%u/%uX%u>>%u", &endian, &sign, &type->bits,
+               &type->storageBits, &type->repeat, &type->shift) != 6 &&
+        sscanf(str.c_str(), "%ce:%c%u/%u>>%u", &endian, &sign, &type->bits, &type->storageBits,
+               &type->shift) != 5)
+        return false;
+    type->bigEndian = endian == 'b';
+    type->isSigned = sign == 's';
+    return type->storageBits % 8 == 0 && type->storageBits > 0 && type->storageBits <= 64 &&
+           type->bits <= type->storageBits;
+}
+
+bool AmbientLightSensor::setupIio(const std::string& sysfsDir, Format* format) {
+    const std::string scanDir = sysfsDir + "/scan_elements";
+    const std::string element = findIlluminanceElement(scanDir);
+    struct Channel {
+        int index;
+        size_t bytes;
+        bool ours;
+    };
+    std::vector<Channel> channels;
+    ChannelType ours = {};
+
+    if (element.empty()) {
+        LOG(ERROR) << sysfsDir << " has no illuminance channel";
+        return false;
+    }
+    // The buffer must be off while its channels change
+    if (!writeValue(sysfsDir + "/buffer/enable", "0") ||
+        !writeValue(scanDir + "/" + element + "_en", "1"))
+        return false;
+
+    // Samples hold every enabled channel, ordered by index and each aligned
+    // to its own size
+    for (const auto& name : listDir(scanDir)) {
+        if (!endsWith(name, "_en")) continue;
+        const std::string base = scanDir + "/" + name.substr(0, name.size() - 3);
+        int enabled = 0, index;
+        ChannelType type;
+        if (!readValue(scanDir + "/" + name, &enabled) || !enabled) continue;
+        if (!readValue(base + "_index", &index) || !readChannelType(base + "_type", &type)) {
+            LOG(ERROR) << "Cannot parse scan element " << base;
+            return false;
+        }
+        const bool isOurs = name == element + "_en";
+        if (isOurs) ours = type;
+        channels.push_back({index, type.storageBits / 8 * type.repeat, isOurs});
+    }
+    std::sort(channels.begin(), channels.end(),
+              [](const Channel& a, const Channel& b) { return a.index < b.index; });
+
+    size_t offset = 0, maxBytes = 1;
+    for (const auto& channel : channels) {
+        offset = (offset + channel.bytes - 1) / channel.bytes * channel.bytes;
+        if (channel.ours) format->offset = offset;
+        offset += channel.bytes;
+        maxBytes = std::max(maxBytes, channel.bytes);
+    }
+    format->sampleBytes = (offset + maxBytes - 1) / maxBytes * maxBytes;
+    format->storageBytes = ours.storageBits / 8;
+    format->bits = ours.bits;
+    format->shift = ours.shift;
+    format->isSigned = ours.isSigned;
+    format->bigEndian = ours.bigEndian;
+    format->rawOffset = 0;
+    format->scale = 1;
+    const std::string info = sysfsDir + "/" + element;
+    readValue(info + "_offset", &format->rawOffset);
+    readValue(info + "_scale", &format->scale);
+    if (format->sampleBytes > sizeof(mPending)) {
+        LOG(ERROR) << "Samples of " << sysfsDir << " too large: " << format->sampleBytes;
+        return false;
+    }
+    return writeValue(sysfsDir + "/buffer/enable", "1");
+}
+
+std::unique_ptr<AmbientLightSensor> AmbientLightSensor::open(const std::string& path,
+                                                             const Thresholds& thresholds,
+                                                             Callback callback) {
+    std::string sysfsDir;
+    // Stand-in default, native endian u32 lux
+    Format format = {sizeof(uint32_t), 0, sizeof(uint32_t), 32, 0, false,
+                     __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__, 0, 1};
+
+    if (thresholds.exitLux >= thresholds.enterLux) {
+        LOG(ERROR) << "Sunlight exit threshold must be below enter threshold";
+        return nullptr;
+    }
+    if (path.rfind(IIO_DEVICE_PREFIX, 0) == 0) {
+        sysfsDir = std::string(IIO_SYSFS_DIR) + path.substr(path.rfind('/'));
+        if (!setupIio(sysfsDir, &format)) return nullptr;
+    }
+    auto sensor = std::unique_ptr<AmbientLightSensor>(
+            new AmbientLightSensor(path, sysfsDir, format, thresholds, std::move(callback)));
+    if (sensor->mFd < 0) return nullptr;
+    sensor->mThread = std::thread(&AmbientLightSensor::watchLoop, sensor.get());
+    return sensor;
+}
+
+AmbientLightSensor::AmbientLightSensor(const std::string& path, const std::string& sysfsDir,
+                                       const Format& format, const Thresholds& thresholds,
+                                       Callback callback)
+    : mPath(path),
+      mSysfsDir(sysfsDir),
+      mFormat(format),
+      mThresholds(thresholds),
+      mCallback(std::move(callback)) {
+    mEpollFd.reset(epoll_create1(EPOLL_CLOEXEC));
+    mStopFd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (mEpollFd < 0 || mStopFd < 0) {
+        PLOG(ERROR) << "Failed to set up epoll";
+        return;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = mStopFd;
+    epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mStopFd, &ev);
+    reopen();
+}
+
+AmbientLightSensor::~AmbientLightSensor() {
+    if (mThread.joinable()) {
+        uint64_t val = 1;
+        TEMP_FAILURE_RETRY(write(mStopFd, &val, sizeof(val)));
+        mThread.join();
+    }
+    if (!mSysfsDir.empty()) writeValue(mSysfsDir + "/buffer/enable", "0");
+}
+
+// A FIFO hangs up once its writer goes away, opening it again waits for the next one
+bool AmbientLightSensor::reopen() {
+    if (mFd >= 0) epoll_ctl(mEpollFd, EPOLL_CTL_DEL, mFd, nullptr);
+    mFd.reset(::open(mPath.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC));
+    if (mFd < 0) {
+        PLOG(ERROR) << "Failed to open " << mPath;
+        return false;
+    }
+    mPendingBytes = 0;
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = mFd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mFd, &ev) < 0) {
+        PLOG(ERROR) << "Failed to watch " << mPath;
+        mFd.reset();
+        return false;
+    }
+    return true;
+}
+
+double AmbientLightSensor::decode(const uint8_t* sample) const {
+    const uint8_t* p = sample + mFormat.offset;
+    uint64_t raw = 0;
+
+    for (size_t i = 0; i < mFormat.storageBytes; ++i) {
+        const size_t byte = mFormat.bigEndian ? i : mFormat.storageBytes - 1 - i;
+        raw = (raw << 8) | p[byte];
+    }
+    raw >>= mFormat.shift;
+    if (mFormat.bits < 64) raw &= (uint64_t(1) << mFormat.bits) - 1;
+
+    double value = raw;
+    if (mFormat.isSigned && mFormat.bits < 64 && (raw >> (mFormat.bits - 1)) & 1)
+        value -= double(uint64_t(1) << mFormat.bits);
+    return (value + mFormat.rawOffset) * mFormat.scale;
+}
+
+void AmbientLightSensor::onSample(const double lux) {
+    int sunlight = mSunlight;
+
+    if (mSunlight != 1 && lux >= mThresholds.enterLux)
+        sunlight = 1;
+    else if (mSunlight != 0 && lux <= mThresholds.exitLux)
+        sunlight = 0;
+    else if (mSunlight == -1)
+        // Between the thresholds, stay out of sunlight mode
+        sunlight = 0;
+    if (sunlight == mSunlight) return;
+    LOG(DEBUG) << "Ambient light " << lux << " lux, sunlight mode " << sunlight;
+    mSunlight = sunlight;
+    mCallback(sunlight);
+}
+
+void AmbientLightSensor::watchLoop() {
+    struct epoll_event events[2];
+
+    while (true) {
+        const int n = TEMP_FAILURE_RETRY(epoll_wait(mEpollFd, events, std::size(events), -1));
+        if (n < 0) {
+            PLOG(ERROR) << "epoll_wait";
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == mStopFd) return;
+            if (events[i].events & EPOLLIN) {
+                // Only whole samples are decoded, a FIFO may split them
+                const ssize_t len = TEMP_FAILURE_RETRY(read(
+                        mFd, mPending + mPendingBytes, sizeof(mPending) - mPendingBytes));
+                if (len > 0) {
+                    mPendingBytes += len;
+                    size_t used = 0;
+                    double lux = 0;
+                    for (; mPendingBytes - used >= mFormat.sampleBytes;
+                         used += mFormat.sampleBytes)
+                        lux = decode(mPending + used);
+                    // Every sample but the newest is stale already
+                    if (used > 0) onSample(lux);
+                    memmove(mPending, mPending + used, mPendingBytes - used);
+                    mPendingBytes -= used;
+                    continue;
+                }
+                if (len < 0 && errno == EAGAIN) continue;
+            }
+            if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLIN)) {
+                // Drained, writer or device gone
+                if (!reopen()) return;
+            }
+        }
+    }
+}
+
+} // namespace light
+} // namespace hardware
+} // namespace android
+} // namespace aidl
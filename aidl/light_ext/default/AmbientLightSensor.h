@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+/*
+ * Watches an ambient light sensor and reports when it is bright enough
+ * for sunlight mode, with hysteresis.
+ *
+ * Samples are read from the buffered character device of an IIO sensor,
+ * /dev/iio:deviceN, with epoll on its own thread: the sensor wakes the
+ * thread, nothing polls. Any other path, e.g. a FIFO standing in for the
+ * sensor, is read as native endian unsigned 32-bit lux samples.
+ */
+class AmbientLightSensor {
+  public:
+    // Gets whether sunlight mode should be on, called on the sensor thread
+    using Callback = std::function<void(bool sunlight)>;
+
+    struct Thresholds {
+        // Sunlight mode turns on at or above this many lux
+        double enterLux;
+        // And off again at or below this, lower than enterLux
+        double exitLux;
+    };
+
+    /*
+     * Set up the sensor and start watching it. The first sample always
+     * reports, later ones only when crossing a threshold.
+     *
+     * Returns null if the sensor cannot be used.
+     */
+    static std::unique_ptr<AmbientLightSensor> open(const std::string& path,
+                                                    const Thresholds& thresholds,
+                                                    Callback callback);
+    // First IIO device with an illuminance channel, empty if there is none
+    static std::string findIioDevice();
+
+    // Stops the thread and disables the IIO buffer again
+    ~AmbientLightSensor();
+
+  private:
+    // Layout of the illuminance channel within a buffer sample
+    struct Format {
+        size_t sampleBytes;
+        size_t offset;
+        size_t storageBytes;
+        unsigned bits;
+        unsigned shift;
+        bool isSigned;
+        bool bigEndian;
+        // lux = (raw + rawOffset) * scale
+        double rawOffset;
+        double scale;
+    };
+
+    AmbientLightSensor(const std::string& path, const std::string& sysfsDir,
+                       const Format& format, const Thresholds& thresholds, Callback callback);
+
+    // Enable the illuminance channel and the buffer, fills in the format
+    static bool setupIio(const std::string& sysfsDir, Format* format);
+    bool reopen();
+    double decode(const uint8_t* sample) const;
+    void onSample(const double lux);
+    void watchLoop();
+
+    const std::string mPath;
+    // Empty if not an IIO device
+    const std::string mSysfsDir;
+    const Format mFormat;
+    const Thresholds mThresholds;
+    const Callback mCallback;
+
+    ::android::base::unique_fd mFd;
+    ::android::base::unique_fd mEpollFd;
+    // eventfd to stop the thread
+    ::android::base::unique_fd mStopFd;
+    // Partial sample carried over to the next read
+    uint8_t mPending[64];
+    size_t mPendingBytes = 0;
+    // -1 until the first sample
+    int mSunlight = -1;
+    std::thread mThread;
+};
+
+} // namespace light
+} // namespace hardware
+} // namespace android
+} // namespace aidl
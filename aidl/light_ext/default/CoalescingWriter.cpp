@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "vendor.samsung_ext.hardware.lights-service"
+
+#include "CoalescingWriter.h"
+
+#include <android-base/logging.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+using ::android::base::unique_fd;
+
+static void updateMax(std::atomic<int64_t>& max, const int64_t value) {
+    int64_t cur = max.load(std::memory_order_relaxed);
+    while (value > cur && !max.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+        ;
+}
+
+CoalescingWriter::~CoalescingWriter() {
+    if (!mThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStop = true;
+    }
+    mCv.notify_one();
+    mThread.join();
+}
+
+int CoalescingWriter::addNode(const std::string& path) {
+    auto slot = std::make_unique<Slot>();
+
+    slot->path = path;
+    // Kept open, writing is then a single syscall
+    openNode(*slot);
+    mSlots.push_back(std::move(slot));
+    return mSlots.size() - 1;
+}
+
+bool CoalescingWriter::openNode(Slot& slot) {
+    slot.fd.reset(open(slot.path.c_str(), O_WRONLY | O_CLOEXEC));
+    if (slot.fd < 0) {
+        // Tried again on every write, only the first failure is logged
+        if (!slot.openFailed) PLOG(ERROR) << "Failed to open " << slot.path;
+        slot.openFailed = true;
+        return false;
+    }
+    slot.openFailed = false;
+    return true;
+}
+
+void CoalescingWriter::start() {
+    mThread = std::thread(&CoalescingWriter::writeLoop, this);
+}
+
+void CoalescingWriter::publish(const int slotId, const int32_t value) {
+    char buf[16];
+
+    snprintf(buf, sizeof(buf), "%d", value);
+    publish(slotId, std::string(buf));
+}
+
+void CoalescingWriter::publish(const int slotId, const std::string& value) {
+    Slot& slot = *mSlots[slotId];
+    bool wake;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        slot.published.fetch_add(1, std::memory_order_relaxed);
+        if (slot.pending) {
+            // Never reached the node, the writer skips it
+            slot.dropped.fetch_add(1, std::memory_order_relaxed);
+            wake = false;
+        } else {
+            slot.pending = true;
+            slot.publishedAt = Clock::now();
+            wake = true;
+        }
+        slot.value = value + '\n';
+    }
+    if (wake) mCv.notify_one();
+}
+
+void CoalescingWriter::write(Slot& slot, const std::string& value,
+                             const Clock::time_point publishedAt) {
+    using std::chrono::nanoseconds;
+    const auto start = Clock::now();
+
+    // Not ready or not accessible yet when the HAL started, or gone since,
+    // e.g. its driver rebound, so open it again.
+    const auto writeNode = [&] {
+        return TEMP_FAILURE_RETRY(pwrite(slot.fd, value.data(), value.size(), 0)) >= 0;
+    };
+    bool ok = slot.fd >= 0 ? writeNode() : openNode(slot) && writeNode();
+    if (!ok && slot.fd >= 0) ok = openNode(slot) && writeNode();
+    if (!ok) {
+        slot.failed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const auto end = Clock::now();
+    const int64_t writeNs = std::chrono::duration_cast<nanoseconds>(end - start).count();
+    slot.written.fetch_add(1, std::memory_order_relaxed);
+    slot.writeTotalNs.fetch_add(writeNs, std::memory_order_relaxed);
+    updateMax(slot.writeMaxNs, writeNs);
+    updateMax(slot.queueMaxNs,
+              std::chrono::duration_cast<nanoseconds>(end - publishedAt).count());
+}
+
+void CoalescingWriter::writeLoop() {
+    struct Taken {
+        Slot* slot;
+        std::string value;
+        Clock::time_point publishedAt;
+    };
+    std::vector<Taken> taken;
+    std::unique_lock<std::mutex> lock(mLock);
+
+    while (true) {
+        mCv.wait(lock, [this] {
+            if (mStop) return true;
+            for (const auto& slot : mSlots)
+                if (slot->pending) return true;
+            return false;
+        });
+        if (mStop) return;
+
+        taken.clear();
+        for (auto& slot : mSlots) {
+            if (!slot->pending) continue;
+            taken.push_back({slot.get(), std::move(slot->value), slot->publishedAt});
+            slot->pending = false;
+        }
+        // Publishing goes on meanwhile, whatever comes in is written next round
+        lock.unlock();
+        for (const auto& t : taken) write(*t.slot, t.value, t.publishedAt);
+        lock.lock();
+    }
+}
+
+void CoalescingWriter::dump(const int fd) const {
+    const auto load = [](const auto& v) { return v.load(std::memory_order_relaxed); };
+
+    for (const auto& slot : mSlots) {
+        const uint64_t written = load(slot->written);
+        dprintf(fd, "%s:\n", slot->path.c_str());
+        dprintf(fd, "  Published: %llu, written: %llu, dropped: %llu, failed: %llu\n",
+                (unsigned long long)load(slot->published), (unsigned long long)written,
+                (unsigned long long)load(slot->dropped), (unsigned long long)load(slot->failed));
+        dprintf(fd, "  Write latency (avg/max): %lldus %lldus, publish to written max: %lldus\n",
+                (long long)(written ? load(slot->writeTotalNs) / written / 1000 : 0),
+                (long long)load(slot->writeMaxNs) / 1000,
+                (long long)load(slot->queueMaxNs) / 1000);
+    }
+}
+
+} // namespace light
+} // namespace hardware
+} // namespace android
+} // namespace aidl
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+/*
+ * Writes values to sysfs nodes on its own thread, latest wins.
+ *
+ * Publishing only stores the value in the node's slot and returns. A value
+ * published while the previous one was still waiting replaces it, so under
+ * load the writer skips straight to the newest value instead of replaying
+ * every step of e.g. a brightness animation.
+ */
+class CoalescingWriter {
+  public:
+    CoalescingWriter() = default;
+    ~CoalescingWriter();
+
+    // Register a node before start(), returns the slot to publish to
+    int addNode(const std::string& path);
+    void start();
+
+    void publish(const int slot, const int32_t value);
+    // Written as is, followed by a newline
+    void publish(const int slot, const std::string& value);
+
+    // Counters and write latency of each node, for dumpsys
+    void dump(const int fd) const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Slot {
+        std::string path;
+        // Only used by the writer thread after start()
+        ::android::base::unique_fd fd;
+        // Failing to open was logged already
+        bool openFailed = false;
+        // Protected by mLock
+        bool pending = false;
+        // Newline terminated
+        std::string value;
+        Clock::time_point publishedAt;
+        // Only written by the writer thread, or under mLock
+        std::atomic<uint64_t> published{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> failed{0};
+        // Time spent in write() itself, and from publish until written
+        std::atomic<int64_t> writeTotalNs{0};
+        std::atomic<int64_t> writeMaxNs{0};
+        std::atomic<int64_t> queueMaxNs{0};
+    };
+
+    // (Re)open the node of slot, e.g. once its driver is ready
+    static bool openNode(Slot& slot);
+    void writeLoop();
+    void write(Slot& slot, const std::string& value, const Clock::time_point publishedAt);
+
+    std::vector<std::unique_ptr<Slot>> mSlots;
+    std::mutex mLock;
+    std::condition_variable mCv;
+    bool mStop = false;
+    std::thread mThread;
+};
+
+} // namespace light
+} // namespace hardware
+} // namespace android
+} // namespace aidl
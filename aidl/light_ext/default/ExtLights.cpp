@@ -17,7 +17,7 @@ namespace light {
 
 ndk::ScopedAStatus ExtLights::onPropsChanged(void) {
   if (svc) {
-    svc->handleBacklight_brightness(true, /*unused*/ 0);
+    svc->reloadSunlightProps();
     return ndk::ScopedAStatus::ok();
   } else {
     LOG(ERROR) << __func__ << "svc is NULL";
@@ -25,6 +25,19 @@ ndk::ScopedAStatus ExtLights::onPropsChanged(void) {
   }
 }
 
+ndk::ScopedAStatus ExtLights::setSunlightMode(bool enabled, int32_t ratioPermille) {
+  if (!svc) {
+    LOG(ERROR) << __func__ << "svc is NULL";
+    return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
+  }
+  if (!svc->setSunlightMode(enabled, ratioPermille, /*persist*/ true)) {
+    // Oneway, the caller never sees the status
+    LOG(ERROR) << __func__ << ": ratio " << ratioPermille << " out of range, ignored";
+    return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+  }
+  return ndk::ScopedAStatus::ok();
+}
+
 } // namespace light
 } // namespace hardware
 } // namespace samsung_ext
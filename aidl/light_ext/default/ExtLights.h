@@ -19,6 +19,7 @@ namespace light {
 
 struct ExtLights : public BnExtLights {
     ndk::ScopedAStatus onPropsChanged() override;
+    ndk::ScopedAStatus setSunlightMode(bool enabled, int32_t ratioPermille) override;
     std::shared_ptr<Lights> svc;
 };
 
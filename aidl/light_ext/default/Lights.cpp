@@ -6,9 +6,13 @@
 
 #define LOG_TAG "vendor.samsung_ext.hardware.lights-service"
 
+#include <android-base/logging.h>
 #include <android-base/stringprintf.h>
 #include <android-base/properties.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <fstream>
 #include <mutex>
 
@@ -16,24 +20,58 @@
 
 constexpr const int COLOR_MASK = 0x00ffffff;
 constexpr const int MAX_INPUT_BRIGHTNESS = 255;
-constexpr const float SUNLIGHT_RATIO = 0.8f;
+constexpr const int32_t DEFAULT_SUNLIGHT_RATIO = 800;
+// Sunlight ratio range, in permille
+constexpr const int32_t MIN_SUNLIGHT_RATIO = 1;
+constexpr const int32_t MAX_SUNLIGHT_RATIO = 2000;
 
 static const char SUNLIGHT_ENABLED_PROP[] = "persist.vendor.ext.sunlight.on";
+static const char SUNLIGHT_RATIO_PROP[] = "persist.vendor.ext.sunlight.ratio";
+// Auto sunlight mode, driven by the ambient light sensor
+static const char SUNLIGHT_AUTO_PROP[] = "persist.vendor.ext.sunlight.auto";
+// Sensor to use, an IIO device or a stand-in. Empty to find the IIO device.
+static const char SUNLIGHT_SENSOR_PROP[] = "persist.vendor.ext.sunlight.sensor";
+static const char SUNLIGHT_ENTER_LUX_PROP[] = "persist.vendor.ext.sunlight.enter_lux";
+static const char SUNLIGHT_EXIT_LUX_PROP[] = "persist.vendor.ext.sunlight.exit_lux";
+// Direct sunlight is tens of thousands of lux, overcast daylight below 10000
+constexpr const int32_t DEFAULT_SUNLIGHT_ENTER_LUX = 20000;
+constexpr const int32_t DEFAULT_SUNLIGHT_EXIT_LUX = 10000;
 
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace light {
 
+#ifdef LED_BLINK_NODE
 /*
- * Write value to path and close file.
+ * Per channel LED output of every 8-bit input, with the channel adjustment
+ * and light brightness factor folded in.
  */
-template <typename T>
-static void set(const std::string& path, const T& value) {
-    std::ofstream file(path);
-    file << value << std::endl;
+using LedTable = std::array<uint8_t, MAX_INPUT_BRIGHTNESS + 1>;
+struct LedTables {
+    LedTable red, green, blue;
+};
+
+static_assert(LED_ADJUSTMENT_R <= 1.0 && LED_ADJUSTMENT_G <= 1.0 && LED_ADJUSTMENT_B <= 1.0,
+              "LED adjustment factors must be within 0.0-1.0");
+
+static constexpr LedTable makeLedTable(const double adjustment, const int32_t brightness) {
+    LedTable table{};
+    for (int32_t i = 0; i <= MAX_INPUT_BRIGHTNESS; ++i)
+        table[i] = static_cast<uint32_t>(i * adjustment) * brightness / MAX_INPUT_BRIGHTNESS;
+    return table;
+}
+
+static constexpr LedTables makeLedTables(const int32_t brightness) {
+    return {makeLedTable(LED_ADJUSTMENT_R, brightness), makeLedTable(LED_ADJUSTMENT_G, brightness),
+            makeLedTable(LED_ADJUSTMENT_B, brightness)};
 }
 
+static constexpr LedTables kBatteryLed = makeLedTables(LED_BRIGHTNESS_BATTERY);
+static constexpr LedTables kNotificationLed = makeLedTables(LED_BRIGHTNESS_NOTIFICATION);
+static constexpr LedTables kAttentionLed = makeLedTables(LED_BRIGHTNESS_ATTENTION);
+#endif /* LED_BLINK_NODE */
+
 template <typename T>
 static T get(const std::string& path, const T& def) {
     std::ifstream file(path);
@@ -44,9 +82,38 @@ static T get(const std::string& path, const T& def) {
 }
 
 using ::android::base::GetBoolProperty;
+using ::android::base::GetIntProperty;
+using ::android::base::GetProperty;
 using ::android::base::SetProperty;
 
+// Scale panel brightness by a sunlight ratio, without going over the panel
+static int32_t applySunlightRatio(const int32_t brightness, const int32_t ratio,
+                                  const int32_t max_brightness) {
+    return std::min(brightness * ratio / 1000, max_brightness);
+}
+
 Lights::Lights() {
+    mMaxBrightness = get(PANEL_MAX_BRIGHTNESS_NODE, MAX_INPUT_BRIGHTNESS);
+    // In auto mode, off until the sensor says otherwise
+    sunlight_data.enabled = !GetBoolProperty(SUNLIGHT_AUTO_PROP, false) &&
+                            GetBoolProperty(SUNLIGHT_ENABLED_PROP, false);
+    sunlight_data.ratio_permille = GetIntProperty(SUNLIGHT_RATIO_PROP, DEFAULT_SUNLIGHT_RATIO,
+                                                  MIN_SUNLIGHT_RATIO, MAX_SUNLIGHT_RATIO);
+    buildBacklightTable();
+    mPersistThread = std::thread(&Lights::persistLoop, this);
+
+    mBacklightSlot = mWriter.addNode(PANEL_BRIGHTNESS_NODE);
+#ifdef BUTTON_BRIGHTNESS_NODE
+    mButtonSlot = mWriter.addNode(BUTTON_BRIGHTNESS_NODE);
+#endif /* BUTTON_BRIGHTNESS_NODE */
+#ifdef LED_BLINK_NODE
+    mLedBlinkSlot = mWriter.addNode(LED_BLINK_NODE);
+#ifdef LED_BLN_NODE
+    mLedBlnSlot = mWriter.addNode(LED_BLN_NODE);
+#endif /* LED_BLN_NODE */
+#endif /* LED_BLINK_NODE */
+    mWriter.start();
+
     mLights.emplace(LightType::BACKLIGHT,
                     std::bind(&Lights::handleBacklight, this, std::placeholders::_1));
 #ifdef BUTTON_BRIGHTNESS_NODE
@@ -59,6 +126,23 @@ Lights::Lights() {
     mLights.emplace(LightType::ATTENTION,
                     std::bind(&Lights::handleAttention, this, std::placeholders::_1));
 #endif /* LED_BLINK_NODE */
+
+    // Last, its callback needs everything above
+    updateAmbientSensor();
+}
+
+Lights::~Lights() {
+    {
+        // Stop its thread before anything it calls into goes away
+        std::lock_guard<std::mutex> lock(mAmbientLock);
+        mAmbientSensor.reset();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mPersistLock);
+        mPersist.stop = true;
+    }
+    mPersistCv.notify_one();
+    mPersistThread.join();
 }
 
 ndk::ScopedAStatus Lights::setLightState(int32_t id, const HwLightState& state) {
@@ -69,56 +153,160 @@ ndk::ScopedAStatus Lights::setLightState(int32_t id, const HwLightState& state)
         return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
     }
 
-    /*
-     * Lock global mutex until light state is updated.
-     */
-    std::lock_guard<std::mutex> lock(mLock);
-
+    // Handlers lock whatever state their light owns
     it->second(state);
 
     return ndk::ScopedAStatus::ok();
 }
 
+// mBacklightLock must be held
+void Lights::buildBacklightTable() {
+    for (int32_t i = 0; i <= MAX_INPUT_BRIGHTNESS; ++i) {
+#ifdef PANEL_BRIGHTNESS_GAMMA
+        int32_t brightness = std::lround(
+                mMaxBrightness * std::pow(i / double(MAX_INPUT_BRIGHTNESS), PANEL_BRIGHTNESS_GAMMA));
+#else
+        int32_t brightness = i * mMaxBrightness / MAX_INPUT_BRIGHTNESS;
+#endif /* PANEL_BRIGHTNESS_GAMMA */
+        if (sunlight_data.enabled) {
+            // If enabled, apply ratio.
+            brightness = applySunlightRatio(brightness, sunlight_data.ratio_permille,
+                                            mMaxBrightness);
+        }
+        // Gamma or a low ratio may round the dimmest levels down, only 0 is off
+        if (i > 0) brightness = std::max(brightness, 1);
+        mBacklightTable[i] = brightness;
+    }
+}
+
 void Lights::handleBacklight_brightness(const bool fromExtHal, const uint32_t brightness_s) {
-    static int32_t max_brightness;
-    static std::once_flag once;
-    static bool need_conversion;
     int32_t brightness;
-
-    std::call_once(once, [this]{ 
-         max_brightness = get(PANEL_MAX_BRIGHTNESS_NODE, MAX_INPUT_BRIGHTNESS);
-         need_conversion = max_brightness != MAX_INPUT_BRIGHTNESS;
-         sunlight_data.enabled = GetBoolProperty(SUNLIGHT_ENABLED_PROP, false);
-    });
+    std::lock_guard<std::mutex> lock(mBacklightLock);
 
     if (!fromExtHal) {
         // If it wasn't called from ExtHAL...
-        brightness = brightness_s;
-        if (need_conversion) {
-             brightness = brightness * max_brightness / MAX_INPUT_BRIGHTNESS;
-        }
-        sunlight_data.requested_brightness = brightness;
+        sunlight_data.requested_brightness =
+                std::min<uint32_t>(brightness_s, MAX_INPUT_BRIGHTNESS);
+        brightness = mBacklightTable[sunlight_data.requested_brightness];
     } else {
-        // New enabled data from onPropsChanged()
-        sunlight_data.enabled = GetBoolProperty(SUNLIGHT_ENABLED_PROP, false);
-        // If the call was from ExtHAL, brightness is from cache
-        brightness = sunlight_data.requested_brightness;
-        if (brightness == -1) {
+        // Sunlight mode changed through ExtHAL, brightness is from cache
+        if (sunlight_data.requested_brightness != -1) {
+            brightness = mBacklightTable[sunlight_data.requested_brightness];
+        } else {
             // If brightness is -1 (Meaning not initialized), then better not set backlight to negative
-            // cuz that... Just read it from sysfs
+            // cuz that... Just read it from sysfs, it is panel brightness already
             brightness = get(PANEL_BRIGHTNESS_NODE, -1);
             if (brightness == -1) {
                 // OK Kys
                 return;
             }
+            if (sunlight_data.enabled) {
+                brightness = applySunlightRatio(brightness, sunlight_data.ratio_permille,
+                                                mMaxBrightness);
+            }
+        }
+    }
+
+    mWriter.publish(mBacklightSlot, brightness);
+}
+
+bool Lights::setSunlightMode(const bool enabled, const int32_t ratioPermille,
+                             const bool persist) {
+    if (ratioPermille < MIN_SUNLIGHT_RATIO || ratioPermille > MAX_SUNLIGHT_RATIO) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mBacklightLock);
+        if (enabled != sunlight_data.enabled || ratioPermille != sunlight_data.ratio_permille) {
+            sunlight_data.enabled = enabled;
+            sunlight_data.ratio_permille = ratioPermille;
+            buildBacklightTable();
         }
     }
-    if (sunlight_data.enabled) {
-        // If enabled, apply ratio.
-        brightness *= SUNLIGHT_RATIO;
+    if (persist) {
+        {
+            std::lock_guard<std::mutex> lock(mPersistLock);
+            mPersist.pending = true;
+            mPersist.enabled = enabled;
+            mPersist.ratio_permille = ratioPermille;
+        }
+        mPersistCv.notify_one();
     }
+    handleBacklight_brightness(true, /*unused*/ 0);
+    return true;
+}
 
-    set(PANEL_BRIGHTNESS_NODE, brightness);
+void Lights::reloadSunlightProps() {
+    const int32_t ratio = GetIntProperty(SUNLIGHT_RATIO_PROP, DEFAULT_SUNLIGHT_RATIO,
+                                         MIN_SUNLIGHT_RATIO, MAX_SUNLIGHT_RATIO);
+    bool enabled;
+
+    if (GetBoolProperty(SUNLIGHT_AUTO_PROP, false)) {
+        // Up to the sensor, it reports again once restarted
+        std::lock_guard<std::mutex> lock(mBacklightLock);
+        enabled = sunlight_data.enabled;
+    } else {
+        enabled = GetBoolProperty(SUNLIGHT_ENABLED_PROP, false);
+    }
+    setSunlightMode(enabled, ratio, false);
+    updateAmbientSensor();
+}
+
+bool Lights::updateAmbientSensor() {
+    std::lock_guard<std::mutex> lock(mAmbientLock);
+
+    // Gone before a new one sets up the same device
+    mAmbientSensor.reset();
+    if (!GetBoolProperty(SUNLIGHT_AUTO_PROP, false)) return false;
+
+    std::string path = GetProperty(SUNLIGHT_SENSOR_PROP, "");
+    if (path.empty()) path = AmbientLightSensor::findIioDevice();
+    if (path.empty()) {
+        LOG(ERROR) << "No ambient light sensor found, auto sunlight mode unavailable";
+        return false;
+    }
+    const AmbientLightSensor::Thresholds thresholds = {
+            static_cast<double>(GetIntProperty(SUNLIGHT_ENTER_LUX_PROP, DEFAULT_SUNLIGHT_ENTER_LUX,
+                                               1, INT32_MAX)),
+            static_cast<double>(GetIntProperty(SUNLIGHT_EXIT_LUX_PROP, DEFAULT_SUNLIGHT_EXIT_LUX,
+                                               0, INT32_MAX)),
+    };
+    mAmbientSensor = AmbientLightSensor::open(
+            path, thresholds, [this](const bool sunlight) { setAutoSunlight(sunlight); });
+    if (!mAmbientSensor) {
+        LOG(ERROR) << "Cannot use " << path << ", auto sunlight mode unavailable";
+        return false;
+    }
+    LOG(INFO) << "Auto sunlight mode using " << path;
+    return true;
+}
+
+void Lights::setAutoSunlight(const bool enabled) {
+    {
+        std::lock_guard<std::mutex> lock(mBacklightLock);
+        if (enabled == sunlight_data.enabled) return;
+        sunlight_data.enabled = enabled;
+        buildBacklightTable();
+    }
+    handleBacklight_brightness(true, /*unused*/ 0);
+}
+
+void Lights::persistLoop() {
+    std::unique_lock<std::mutex> lock(mPersistLock);
+
+    while (true) {
+        mPersistCv.wait(lock, [this] { return mPersist.pending || mPersist.stop; });
+        if (mPersist.stop) return;
+        const bool enabled = mPersist.enabled;
+        const int32_t ratio = mPersist.ratio_permille;
+        mPersist.pending = false;
+
+        // Whatever is set meanwhile is persisted next round
+        lock.unlock();
+        SetProperty(SUNLIGHT_ENABLED_PROP, enabled ? "true" : "false");
+        SetProperty(SUNLIGHT_RATIO_PROP, std::to_string(ratio));
+        lock.lock();
+    }
 }
 
 void Lights::handleBacklight(const HwLightState& state) {
@@ -133,41 +321,45 @@ void Lights::handleButtons(const HwLightState& state) {
     uint32_t brightness = (state.color & COLOR_MASK) ? 1 : 0;
 #endif
 
-    set(BUTTON_BRIGHTNESS_NODE, brightness);
+    mWriter.publish(mButtonSlot, brightness);
 }
 #endif
 
 #ifdef LED_BLINK_NODE
 void Lights::handleBattery(const HwLightState& state) {
+    std::lock_guard<std::mutex> lock(mLedLock);
     mBatteryState = state;
     setNotificationLED();
 }
 
 void Lights::handleNotifications(const HwLightState& state) {
+    std::lock_guard<std::mutex> lock(mLedLock);
     mNotificationState = state;
     setNotificationLED();
 }
 
 void Lights::handleAttention(const HwLightState& state) {
+    std::lock_guard<std::mutex> lock(mLedLock);
     mAttentionState = state;
     setNotificationLED();
 }
 
+// mLedLock must be held
 void Lights::setNotificationLED() {
-    int32_t adjusted_brightness = MAX_INPUT_BRIGHTNESS;
+    const LedTables* tables;
     HwLightState state;
 #ifdef LED_BLN_NODE
     bool bln = false;
 #endif /* LED_BLN_NODE */
 
     if (mNotificationState.color & COLOR_MASK) {
-        adjusted_brightness = LED_BRIGHTNESS_NOTIFICATION;
+        tables = &kNotificationLed;
         state = mNotificationState;
 #ifdef LED_BLN_NODE
         bln = true;
 #endif /* LED_BLN_NODE */
     } else if (mAttentionState.color & COLOR_MASK) {
-        adjusted_brightness = LED_BRIGHTNESS_ATTENTION;
+        tables = &kAttentionLed;
         state = mAttentionState;
         if (state.flashMode == FlashMode::HARDWARE) {
             if (state.flashOnMs > 0 && state.flashOffMs == 0) state.flashMode = FlashMode::NONE;
@@ -177,10 +369,10 @@ void Lights::setNotificationLED() {
             state.color = 0;
         }
     } else if (mBatteryState.color & COLOR_MASK) {
-        adjusted_brightness = LED_BRIGHTNESS_BATTERY;
+        tables = &kBatteryLed;
         state = mBatteryState;
     } else {
-        set(LED_BLINK_NODE, "0x00000000 0 0");
+        mWriter.publish(mLedBlinkSlot, "0x00000000 0 0");
         return;
     }
 
@@ -189,24 +381,21 @@ void Lights::setNotificationLED() {
         state.flashOffMs = 0;
     }
 
-    state.color = calibrateColor(state.color & COLOR_MASK, adjusted_brightness);
-    set(LED_BLINK_NODE, ::android::base::StringPrintf("0x%08x %d %d", state.color, state.flashOnMs,
-                                                    state.flashOffMs));
+    state.color = calibrateColor(state.color & COLOR_MASK, *tables);
+    mWriter.publish(mLedBlinkSlot, ::android::base::StringPrintf("0x%08x %d %d", state.color,
+                                                                 state.flashOnMs,
+                                                                 state.flashOffMs));
 
 #ifdef LED_BLN_NODE
     if (bln) {
-        set(LED_BLN_NODE, (state.color & COLOR_MASK) ? 1 : 0);
+        mWriter.publish(mLedBlnSlot, (state.color & COLOR_MASK) ? 1 : 0);
     }
 #endif /* LED_BLN_NODE */
 }
 
-uint32_t Lights::calibrateColor(uint32_t color, int32_t brightness) {
-    uint32_t red = ((color >> 16) & 0xFF) * LED_ADJUSTMENT_R;
-    uint32_t green = ((color >> 8) & 0xFF) * LED_ADJUSTMENT_G;
-    uint32_t blue = (color & 0xFF) * LED_ADJUSTMENT_B;
-
-    return (((red * brightness) / 255) << 16) + (((green * brightness) / 255) << 8) +
-           ((blue * brightness) / 255);
+uint32_t Lights::calibrateColor(uint32_t color, const LedTables& tables) {
+    return (tables.red[(color >> 16) & 0xFF] << 16) + (tables.green[(color >> 8) & 0xFF] << 8) +
+           tables.blue[color & 0xFF];
 }
 #endif /* LED_BLINK_NODE */
 
@@ -220,6 +409,11 @@ ndk::ScopedAStatus Lights::getLights(std::vector<HwLight> *_aidl_return) {
     return ndk::ScopedAStatus::ok();
 }
 
+binder_status_t Lights::dump(int fd, const char** /* args */, uint32_t /* numArgs */) {
+    mWriter.dump(fd);
+    return STATUS_OK;
+}
+
 uint32_t Lights::rgbToBrightness(const HwLightState& state) {
     uint32_t color = state.color & COLOR_MASK;
 
@@ -7,7 +7,14 @@
 #pragma once
 
 #include <aidl/android/hardware/light/BnLights.h>
+#include <array>
+#include <memory>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include "AmbientLightSensor.h"
+#include "CoalescingWriter.h"
 #include "samsung_lights.h"
 
 using ::aidl::android::hardware::light::HwLightState;
@@ -18,15 +25,31 @@ namespace android {
 namespace hardware {
 namespace light {
 
+struct LedTables;
+
 class Lights : public BnLights {
 public:
     Lights();
+    ~Lights();
 
     ndk::ScopedAStatus setLightState(int32_t id, const HwLightState& state) override;
     ndk::ScopedAStatus getLights(std::vector<HwLight> *_aidl_return) override;
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
 
     void handleBacklight_brightness(const bool fromExtHal, const uint32_t brightness);
 
+    /*
+     * Apply sunlight mode and show it right away. If persist is set, the
+     * properties are written in background, latest mode wins.
+     * Returns false if ratioPermille is out of range.
+     */
+    bool setSunlightMode(const bool enabled, const int32_t ratioPermille, const bool persist);
+    /*
+     * Apply sunlight mode from its properties, e.g. set by an older client.
+     * In auto mode the ambient light sensor is restarted and decides again.
+     */
+    void reloadSunlightProps();
+
 private:
     void handleBacklight(const HwLightState& state);
 #ifdef BUTTON_BRIGHTNESS_NODE
@@ -37,22 +60,70 @@ private:
     void handleNotifications(const HwLightState& state);
     void handleAttention(const HwLightState& state);
     void setNotificationLED();
-    uint32_t calibrateColor(uint32_t color, int32_t brightness);
+    uint32_t calibrateColor(uint32_t color, const LedTables& tables);
 
+    // The LED shows one of these at a time, arbitrated under mLedLock. Held
+    // while publishing, so the newest state is the one written last.
     HwLightState mAttentionState;
     HwLightState mBatteryState;
     HwLightState mNotificationState;
+    std::mutex mLedLock;
 #endif /* LED_BLINK_NODE */
 
     uint32_t rgbToBrightness(const HwLightState& state);
 
-    std::mutex mLock;
+    // Each light owns its state and lock, a slow LED write does not hold up
+    // the backlight or the other way around. Immutable after construction.
     std::unordered_map<LightType, std::function<void(const HwLightState&)>> mLights;
 
+    // Light nodes are written off the binder thread, latest value wins
+    CoalescingWriter mWriter;
+    int mBacklightSlot;
+#ifdef BUTTON_BRIGHTNESS_NODE
+    int mButtonSlot;
+#endif /* BUTTON_BRIGHTNESS_NODE */
+#ifdef LED_BLINK_NODE
+    int mLedBlinkSlot;
+#ifdef LED_BLN_NODE
+    int mLedBlnSlot;
+#endif /* LED_BLN_NODE */
+#endif /* LED_BLINK_NODE */
+
     struct {
        bool enabled;
+       int32_t ratio_permille;
+       // Input brightness, 0-255
        int32_t requested_brightness = -1;
     } sunlight_data;
+    int32_t mMaxBrightness;
+    // Panel brightness of every input brightness, with panel scaling, gamma
+    // and sunlight ratio applied. Rebuilt when sunlight mode changes.
+    std::array<int32_t, 256> mBacklightTable;
+    void buildBacklightTable();
+    // Protect above state, backlight only
+    std::mutex mBacklightLock;
+
+    // Sunlight mode waiting to be persisted, keeps property service round
+    // trips off the binder thread
+    struct {
+        bool pending;
+        bool stop;
+        bool enabled;
+        int32_t ratio_permille;
+    } mPersist = {};
+    std::mutex mPersistLock;
+    std::condition_variable mPersistCv;
+    std::thread mPersistThread;
+    void persistLoop();
+
+    // Auto sunlight mode, the sensor turns sunlight mode on and off by itself.
+    // Null unless enabled, protected by mAmbientLock.
+    std::unique_ptr<AmbientLightSensor> mAmbientSensor;
+    std::mutex mAmbientLock;
+    // (Re)start the sensor if auto mode is enabled, returns whether it runs
+    bool updateAmbientSensor();
+    // Called from the sensor thread, keeps the ratio and does not persist
+    void setAutoSunlight(const bool enabled);
 };
 
 } // namespace light
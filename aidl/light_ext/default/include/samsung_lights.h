@@ -33,6 +33,9 @@
 // Uncomment to enable variable button brightness
 //#define VAR_BUTTON_BRIGHTNESS 1
 
+// Uncomment to map brightness to the panel through a gamma curve
+//#define PANEL_BRIGHTNESS_GAMMA 2.2
+
 /*
  * Brightness adjustment factors
  *
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 Royna (@roynatech2544 on GH)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "AmbientLightSensor.h"
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using aidl::android::hardware::light::AmbientLightSensor;
+using android::base::unique_fd;
+
+namespace {
+
+constexpr AmbientLightSensor::Thresholds kThresholds = {20000, 10000};
+// Long enough for the sensor thread to pick up a sample
+constexpr auto kQuiet = std::chrono::milliseconds(200);
+constexpr auto kTimeout = std::chrono::seconds(5);
+
+// Stands in for the sensor driver, feeding lux samples through a FIFO
+class AmbientLightSensorTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mPath = std::string(mDir.path) + "/als";
+        ASSERT_EQ(mkfifo(mPath.c_str(), 0600), 0);
+        mSensor = AmbientLightSensor::open(mPath, kThresholds, [this](bool sunlight) {
+            std::lock_guard<std::mutex> lock(mLock);
+            mEvents.push_back(sunlight);
+            mCond.notify_all();
+        });
+        ASSERT_NE(mSensor, nullptr);
+        connect();
+    }
+
+    // Blocks until the sensor has the FIFO open for reading
+    void connect() {
+        mWriter.reset(::open(mPath.c_str(), O_WRONLY | O_CLOEXEC));
+        ASSERT_GE(mWriter, 0);
+    }
+
+    void write(const void* data, size_t size) {
+        ASSERT_EQ(::write(mWriter, data, size), static_cast<ssize_t>(size));
+    }
+
+    void send(const uint32_t lux) { write(&lux, sizeof(lux)); }
+
+    // Wait until the callback has been called count times in total
+    bool waitEvents(const size_t count, const std::chrono::milliseconds timeout = kTimeout) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mCond.wait_for(lock, timeout, [&] { return mEvents.size() >= count; });
+    }
+
+    std::vector<bool> events() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mEvents;
+    }
+
+    TemporaryDir mDir;
+    std::string mPath;
+    // Used by the callback, outlive the sensor thread
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::vector<bool> mEvents;
+
+    std::unique_ptr<AmbientLightSensor> mSensor;
+    unique_fd mWriter;
+};
+
+TEST_F(AmbientLightSensorTest, FirstSampleReports) {
+    // Between the thresholds, starts out of sunlight mode
+    send(15000);
+    ASSERT_TRUE(waitEvents(1));
+    EXPECT_EQ(events(), std::vector<bool>({false}));
+}
+
+TEST_F(AmbientLightSensorTest, Hysteresis) {
+    send(500);
+    ASSERT_TRUE(waitEvents(1));
+    // Above exit but below enter, no change
+    send(19999);
+    EXPECT_FALSE(waitEvents(2, kQuiet));
+    send(20000);
+    ASSERT_TRUE(waitEvents(2));
+    // Dropping below enter stays in sunlight mode until exit
+    send(15000);
+    EXPECT_FALSE(waitEvents(3, kQuiet));
+    send(10001);
+    EXPECT_FALSE(waitEvents(3, kQuiet));
+    send(10000);
+    ASSERT_TRUE(waitEvents(3));
+    send(30000);
+    ASSERT_TRUE(waitEvents(4));
+    EXPECT_EQ(events(), std::vector<bool>({false, true, false, true}));
+}
+
+TEST_F(AmbientLightSensorTest, SplitSamples) {
+    // Each of these changes the mode, so reports once whole
+    const uint32_t samples[] = {500, 25000, 5000};
+
+    for (size_t i = 0; i < std::size(samples); ++i) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&samples[i]);
+
+        write(bytes, 1);
+        // Not a whole sample yet
+        EXPECT_FALSE(waitEvents(i + 1, kQuiet));
+        write(bytes + 1, sizeof(samples[i]) - 1);
+        ASSERT_TRUE(waitEvents(i + 1));
+    }
+    EXPECT_EQ(events(), std::vector<bool>({false, true, false}));
+}
+
+TEST_F(AmbientLightSensorTest, ReopensAfterHangup) {
+    send(25000);
+    ASSERT_TRUE(waitEvents(1));
+    // Half a sample is dropped with the writer
+    const uint16_t partial = 0xffff;
+    write(&partial, sizeof(partial));
+    mWriter.reset();
+    // Let the sensor see the hangup before the next writer comes
+    std::this_thread::sleep_for(kQuiet);
+
+    connect();
+    send(5000);
+    ASSERT_TRUE(waitEvents(2));
+    mWriter.reset();
+    std::this_thread::sleep_for(kQuiet);
+
+    connect();
+    send(25000);
+    ASSERT_TRUE(waitEvents(3));
+    EXPECT_EQ(events(), std::vector<bool>({true, false, true}));
+}
+
+} // namespace
@@ -5,6 +5,7 @@
 #include <aidl/vendor/samsung_ext/hardware/light/BnExtLights.h>
 
 #include <cstdio>
+#include <cstdlib>
 #include <unistd.h>
 
 #include <GetServiceSupport.h>
@@ -14,14 +15,21 @@ using aidl::android::hardware::light::ILights;
 using aidl::vendor::samsung_ext::hardware::light::IExtLights;
 
 using android::base::GetBoolProperty;
-using android::base::SetProperty;
 
-int main(void) {
+int main(int argc, char **argv) {
   android::status_t status;
   std::shared_ptr<IExtLights> extsvc;
   static const char SUNLIGHT_ENABLED_PROP[] = "persist.vendor.ext.sunlight.on";
   ndk::SpAIBinder BExtLights;
   bool enable_todo = false;
+  // Optional sunlight ratio in permille, same default as the HAL
+  int ratio = argc > 1 ? atoi(argv[1]) : 800;
+
+  // The call is oneway, the HAL cannot report a bad ratio back
+  if (ratio < 1 || ratio > 2000) {
+    printf("Invalid ratio %d, must be 1-2000 permille\n", ratio);
+    return 1;
+  }
 
   auto svc = getServiceDefault<ILights>();
   if (!svc) {
@@ -38,9 +46,12 @@ int main(void) {
     printf("In IFlashlight::fromBinder: IExtLights object is NULL\n");
     goto exit;
   }
+  // Persisted by the HAL, only read here to toggle
   enable_todo = !GetBoolProperty(SUNLIGHT_ENABLED_PROP, false);
-  SetProperty(SUNLIGHT_ENABLED_PROP, std::to_string(enable_todo));
-  extsvc->onPropsChanged();
+  if (!extsvc->setSunlightMode(enable_todo, ratio).isOk()) {
+    printf("setSunlightMode failed\n");
+    goto exit;
+  }
   return 0;
 exit:
   return 1;
@@ -38,9 +38,10 @@ import com.android.settingslib.widget.MainSwitchPreference
 import com.royna.smartcharge.R
 
 import vendor.samsung_ext.framework.battery.ISmartCharge
+import vendor.samsung_ext.framework.battery.ISmartChargeCallback
+import vendor.samsung_ext.framework.battery.SmartChargeConfig
 
 import java.lang.IllegalArgumentException
-import java.lang.IllegalStateException
 
 class SmartChargeFragment : PreferenceFragmentCompat(), OnCheckedChangeListener {
     private lateinit var mMainSwitch : MainSwitchPreference
@@ -57,6 +58,18 @@ class SmartChargeFragment : PreferenceFragmentCompat(), OnCheckedChangeListener
         ServiceManager.waitForDeclaredService(
         "vendor.samsung_ext.framework.battery.ISmartCharge/default"))
     private lateinit var mSharedPreferences : SharedPreferences
+    // Set while the main switch follows the service, not the user
+    private var mSyncingSwitch = false
+    private val mCallback = object : ISmartChargeCallback.Stub() {
+        override fun onChargeControlChanged(chargingEnabled: Boolean, capacity: Int) {}
+        override fun onCapacityChanged(capacity: Int) {}
+        override fun onConfigChanged(upper: Int, lower: Int, restart: Boolean) {}
+        override fun onLoopStateChanged(running: Boolean, reason: Int) {
+            mMainHandler.post { syncMainSwitch(running, reason) }
+        }
+        override fun getInterfaceVersion() = ISmartChargeCallback.VERSION
+        override fun getInterfaceHash(): String = ISmartChargeCallback.HASH
+    }
 
     override fun onCreatePreferences(savedInstanceState: Bundle?, rootKey: String?) {
         addPreferencesFromResource(R.xml.smartcharge_settings)
@@ -111,6 +124,38 @@ class SmartChargeFragment : PreferenceFragmentCompat(), OnCheckedChangeListener
         updateSeekbarTitles()
     }
 
+    override fun onResume() {
+        super.onResume()
+        runCatching { mService?.registerCallback(mCallback) }.onFailure { Log.w(TAG, it) }
+    }
+
+    override fun onPause() {
+        runCatching { mService?.unregisterCallback(mCallback) }.onFailure { Log.w(TAG, it) }
+        super.onPause()
+    }
+
+    private fun syncMainSwitch(running: Boolean, reason: Int) {
+        if (!isAdded)
+            return
+        if (reason == ISmartChargeCallback.REASON_HEALTH_ERROR) {
+            Toast.makeText(requireContext(),
+                R.string.smart_charge_health_error, Toast.LENGTH_SHORT).show()
+        }
+        if (mMainSwitch.isChecked != running) {
+            mSyncingSwitch = true
+            mMainSwitch.isChecked = running
+            mSyncingSwitch = false
+        }
+        mSharedPreferences.edit().putBoolean(PREF_SMTCHG_ENABLE, running).apply()
+        updateConfigEnabled(running)
+    }
+
+    private fun updateConfigEnabled(running: Boolean) {
+        mStopBar.isEnabled = !running
+        mRestartEnableSwitch.isEnabled = !running
+        mRestartBar.isEnabled = mRestartEnableSwitch.isChecked && !running
+    }
+
     private fun SharedPreferences.getIntZ(value: String): Int {
         getInt(value, -1).apply {
             if (this == -1)
@@ -139,43 +184,42 @@ class SmartChargeFragment : PreferenceFragmentCompat(), OnCheckedChangeListener
     }
 
     override fun onCheckedChanged(buttonView: CompoundButton, isChecked: Boolean) {
+        if (mSyncingSwitch)
+            return
         runCatching {
-            if (isChecked) { when (mConfig) {
-                Config.STOP_RESTART -> {
-                    try { mService?.setChargeLimit(mSharedPreferences.getIntZ(PREF_STOP_CFG),
-                        mSharedPreferences.getIntZ(PREF_RESTART_CFG)) } catch (e: IllegalArgumentException) { throw IllegalStateException() }
+            val config = SmartChargeConfig().apply {
+                upper = mSharedPreferences.getIntZ(PREF_STOP_CFG)
+                lower = when (mConfig) {
+                    Config.STOP_RESTART -> mSharedPreferences.getIntZ(PREF_RESTART_CFG)
+                    Config.STOP -> -1
                 }
-                Config.STOP -> {
-                    mService?.setChargeLimit(mSharedPreferences.getIntZ(PREF_STOP_CFG),-1)
-                }
-            }}
-            mService?.activate(isChecked, mSharedPreferences.getBoolean(PREF_ENABLE_RESTART, false))
+                restart = mConfig == Config.STOP_RESTART
+                enabled = isChecked
+            }
+            // Limits, method and enable state go in one call, all or nothing
+            mService?.setConfig(config)
         }.onFailure {
             when (it) {
-                is IllegalArgumentException -> {
-                    // Switch not synced... Hence do not reset switch
-                    mMainHandler.post {
-                        Toast.makeText(requireContext(),
-                            R.string.smart_charge_internal_error, Toast.LENGTH_SHORT).show()
-                    }
-                }
-                is IllegalStateException -> {
+                is IllegalArgumentException, is NotFoundException -> {
                     // Config error...
                     mMainHandler.post {
-                        mMainSwitch.isChecked = false
+                        syncMainSwitch(!isChecked, ISmartChargeCallback.REASON_REQUESTED)
                         Toast.makeText(requireContext(),
                             R.string.smart_charge_invalid_config, Toast.LENGTH_SHORT).show()
                     }
                 }
                 else -> {
                     Log.w(TAG, it)
+                    mMainHandler.post {
+                        syncMainSwitch(!isChecked, ISmartChargeCallback.REASON_REQUESTED)
+                        Toast.makeText(requireContext(),
+                            R.string.smart_charge_internal_error, Toast.LENGTH_SHORT).show()
+                    }
                 }
             }
         }.onSuccess {
             mSharedPreferences.edit().putBoolean(PREF_SMTCHG_ENABLE, isChecked).apply()
-            mStopBar.isEnabled = !isChecked
-	    mRestartEnableSwitch.isEnabled = !isChecked
-            mRestartBar.isEnabled = mRestartEnableSwitch.isChecked && !isChecked
+            updateConfigEnabled(isChecked)
         }
     }
 
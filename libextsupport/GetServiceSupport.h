@@ -41,3 +41,16 @@ static std::shared_ptr<T> waitServiceDefault(int retries = 5)
 	}
 	return kService;
 }
+
+// Blocks until the service is registered, woken by servicemanager instead of
+// polling. If not declared, just return null right away.
+template <typename T>
+static std::shared_ptr<T> waitForDeclaredServiceDefault(void)
+{
+	const auto kServiceDesc = std::string() + T::descriptor + "/default";
+
+	if (!AServiceManager_isDeclared(kServiceDesc.c_str()))
+		return nullptr;
+	return T::fromBinder(ndk::SpAIBinder(
+		AServiceManager_waitForService(kServiceDesc.c_str())));
+}